@@ -5,18 +5,24 @@
 #include <array>
 #include <vector>
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
 
 #include "gui.h"
+#include "profiler.h"
 #include "datatypes.h"
+#include "renderer.h"
+#include "texture.h"
+#include "chess/engine.h"
 #include "chess/gamestate.h"
+#include "chess/gui.h"
 #include "chess/movement.h"
 #include "chess/fen.h"
 
 int awake(GLFWwindow** window)
 {
         *window = init("Chess", 800, 800);
-        if (window == NULL)
+        if (*window == NULL)
                 return -1;
 
         return 0;
@@ -25,52 +31,169 @@ int awake(GLFWwindow** window)
 const std::string startFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 const std::string castleTestFEN = "r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1";
 
-int update(GLFWwindow* window)
+// Upper bound on how long an idle window sleeps, anything that changes the picture wakes it earlier
+const double idleWaitSeconds = 0.5;
+
+// Reached through the window user pointer from the GLFW callbacks
+struct WindowState
+{
+        bool dirty = true;
+        CursorMapping cursor;
+};
+
+void markDirty(GLFWwindow* window)
+{
+        WindowState* state = (WindowState*)glfwGetWindowUserPointer(window);
+        if (state)
+                state->dirty = true;
+}
+
+void markDirtyOnResize(GLFWwindow* window, int width, int height)
+{
+        (void)width;
+        (void)height;
+        markDirty(window);
+}
+
+void windowResized(GLFWwindow* window, int width, int height)
 {
-        Board board = generateBoard(800, 800, false, {1.f, 1.f, 1.f}, {0.34f, 0.2f, 0.2f});
+        WindowState* state = (WindowState*)glfwGetWindowUserPointer(window);
+        if (state)
+                updateCursorMapping(state->cursor, width, height);
+}
+
+int update(GLFWwindow* window, ImageLoader& pieceImages, std::chrono::steady_clock::time_point startTime)
+{
+        Board board = generateBoard(800, 800, false, lightSquareColor, darkSquareColor);
         BoardState boardState;
-        boardState.pieces.fill({NONE, false});
         if (applyFEN(startFEN, boardState) != 0)
         {
                 std::cerr << "Error parsing FEN\n";
                 return -1;
         }
+        // Filled once the background decode finishes, pieces are drawn as placeholders until then
+        TextureCache textures;
+        TextureAtlas pieceAtlas;
+        bool waitingForTextures = true;
+        bool firstFrame = true;
+        Renderer renderer;
+        if (initRenderer(renderer, 64) != 0)
+        {
+                std::cerr << "Error initializing renderer\n";
+                return -1;
+        }
+        BoardLayers layers;
+        initQuadLayer(layers.squares, 64, 0);
+        initQuadLayer(layers.pieces, 64, 0);
         //printBoardState(boardState);
+
+        // Drawn until the engine publishes its first snapshot
+        PositionSnapshot position;
+        position.boardState = boardState;
+        EngineWorker engine;
+        startEngine(engine, boardState, glfwPostEmptyEvent);
+
         double xpos, ypos;
         bool isMovingPiece = false;
+        WindowState state;
+        int windowWidth, windowHeight;
+        glfwGetWindowSize(window, &windowWidth, &windowHeight);
+        updateCursorMapping(state.cursor, windowWidth, windowHeight);
+        bool& dirty = state.dirty;
+        glfwSetWindowUserPointer(window, &state);
+        glfwSetFramebufferSizeCallback(window, markDirtyOnResize);
+        glfwSetWindowSizeCallback(window, windowResized);
+        glfwSetWindowRefreshCallback(window, markDirty);
         while (!glfwWindowShouldClose(window))
         {
-                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                // Sleep until GLFW reports an event unless a frame is already owed
+                if (dirty)
+                        glfwPollEvents();
+                else
+                        glfwWaitEventsTimeout(idleWaitSeconds);
+                uint64_t frameStart = profiler.enabled ? profileNow() : 0;
 
-                reshapeWindow(window);
-                drawBoard(board, boardState);
-                glfwSwapBuffers(window);
+                // The loader wakes this loop with an empty event when the last image is decoded
+                if (waitingForTextures && imagesReady(pieceImages))
+                {
+                        waitingForTextures = false;
+                        if (finishImageLoader(pieceImages) != 0 || loadPieceTextures(textures, pieceAtlas, pieceImages.images.data()) != 0)
+                        {
+                                std::cerr << "Error loading piece textures, drawing placeholders\n";
+                                freeTextures(textures);
+                                pieceAtlas.rects.clear();
+                        }
+                        else
+                        {
+                                std::cout << "Piece images decoded in " << pieceImages.decodeMilliseconds << " ms, textures ready "
+                                          << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+                                          << " ms after startup\n";
+                        }
+                        pieceImages.images.clear();
+                        dirty = true;
+                }
 
-                processInput(window, boardState, board, xpos, ypos, isMovingPiece);
+                if (processInput(window, state.cursor, position, engine, board, xpos, ypos, isMovingPiece))
+                        dirty = true;
 
-                BoardState tempBoardState = boardState;
-                generatePossibleMoves(tempBoardState);
-                for (int i = 0; i < 64; i++)
+                // The engine wakes this loop with an empty event whenever it publishes a new position
+                if (pollEngineResult(engine, position))
                 {
-                        eliminateCheckMoves(tempBoardState, i);
+                        dirty = true;
+                        Move lastMove = position.lastMove;
+                        setHighlight(board, HIGHLIGHT_LAST_MOVE, lastMove != MOVE_NONE ? squareBB(moveFrom(lastMove)) | squareBB(moveTo(lastMove)) : 0);
+                        setHighlight(board, HIGHLIGHT_CHECK, position.checkedKing);
+                        switch (position.gameState)
+                        {
+                                case CHECKMATE:
+                                        std::cout << "Checkmate!\n";
+                                        std::cout << "Winner: " << (position.boardState.isWhiteTurn ? "Black" : "White") << "\n";
+                                        glfwSetWindowShouldClose(window, true);
+                                        break;
+                                case STALEMATE:
+                                        std::cout << "Stalemate!\n";
+                                        glfwSetWindowShouldClose(window, true);
+                                        break;
+                                default:
+                                        break;
+                        }
                 }
-                switch (checkGameState(tempBoardState))
+
+                if (!dirty)
+                        continue;
+
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                reshapeWindow(window);
+                int width, height;
+                glfwGetFramebufferSize(window, &width, &height);
+                selectAtlasTier(pieceAtlas, (int)(board.squares[0].size / 2 * (width < height ? width : height)));
+                drawBoard(board, position.boardState, renderer, layers, textures, pieceAtlas);
                 {
-                        case CHECKMATE:
-                                std::cout << "Checkmate!\n";
-                                std::cout << "Winner: " << (boardState.isWhiteTurn ? "Black" : "White") << "\n";
-                                glfwSetWindowShouldClose(window, true);
-                                break;
-                        case STALEMATE:
-                                std::cout << "Stalemate!\n";
-                                glfwSetWindowShouldClose(window, true);
-                                break;
-                        default:
-                                break;
+                        PROFILE_SCOPE("glfwSwapBuffers");
+                        glfwSwapBuffers(window);
                 }
-                glfwPollEvents();
+                dirty = false;
+
+                if (firstFrame)
+                {
+                        firstFrame = false;
+                        std::cout << "First frame " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+                                  << " ms after startup" << (waitingForTextures ? ", with placeholder pieces" : "") << "\n";
+                }
+
+                // Idle wakeups that draw nothing are not counted as frames
+                if (profiler.enabled)
+                        recordProfileEvent("frame", frameStart, profileNow() - frameStart);
+                updateProfileOverlay();
         }
 
+        glfwSetWindowUserPointer(window, NULL);
+        stopEngine(engine);
+        freeQuadLayer(layers.squares);
+        freeQuadLayer(layers.pieces);
+        freeRenderer(renderer);
+        freeTextures(textures);
         return 0;
 }
 
@@ -83,10 +206,22 @@ int shutdown()
 
 int chess()
 {
+        auto startTime = std::chrono::steady_clock::now();
+
+        // GLFW is initialized first so that the loader threads can wake the event loop
+        if (!glfwInit())
+                return -1;
+        ImageLoader pieceImages;
+        startLoadingPieceImages(pieceImages, glfwPostEmptyEvent);
+
         GLFWwindow* window;
-        awake(&window);
-        update(window);
+        int result = awake(&window);
+        if (result == 0)
+                update(window, pieceImages, startTime);
+
+        // The loader threads may still post to GLFW, join them before terminating it
+        finishImageLoader(pieceImages);
         shutdown();
 
-        return 0;
+        return result;
 }
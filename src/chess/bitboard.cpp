@@ -0,0 +1,211 @@
+#include "bitboard.h"
+
+std::array<Bitboard, 64> knightAttackTable;
+std::array<Bitboard, 64> kingAttackTable;
+std::array<std::array<Bitboard, 64>, 2> pawnAttackTable;
+std::array<std::array<Bitboard, 64>, 64> betweenTable;
+std::array<std::array<Bitboard, 64>, 64> lineTable;
+
+std::array<Magic, 64> bishopMagics;
+std::array<Magic, 64> rookMagics;
+
+// Sum of 2^popCount(mask) over all squares
+std::array<Bitboard, 0x1480> bishopAttackTable;
+std::array<Bitboard, 0x19000> rookAttackTable;
+
+enum RayDirection
+{
+        NORTH = 0,
+        SOUTH,
+        EAST,
+        WEST,
+        NORTH_EAST,
+        NORTH_WEST,
+        SOUTH_EAST,
+        SOUTH_WEST
+};
+
+// rank and file step for each RayDirection, rank 0 is rank 8
+const int rayDirections[8][2] = {
+        {-1, 0}, {1, 0}, {0, 1}, {0, -1},
+        {-1, 1}, {-1, -1}, {1, 1}, {1, -1}
+};
+
+const int oppositeDirection[8] = {SOUTH, NORTH, WEST, EAST, SOUTH_WEST, SOUTH_EAST, NORTH_WEST, NORTH_EAST};
+
+std::array<std::array<Bitboard, 64>, 8> rayTable;
+
+Bitboard stepAttacks(int square, const int steps[][2], int numSteps)
+{
+        int rank = square / 8;
+        int file = square % 8;
+        Bitboard attacks = 0;
+        for (int i = 0; i < numSteps; i++)
+        {
+                int newRank = rank + steps[i][0];
+                int newFile = file + steps[i][1];
+                if (newRank >= 0 && newRank < 8 && newFile >= 0 && newFile < 8)
+                        attacks |= squareBB(newRank * 8 + newFile);
+        }
+        return attacks;
+}
+
+// Rays towards higher square indices stop at their lowest blocker, the others at their highest.
+// Only used to fill the magic tables.
+Bitboard rayAttacks(int square, int direction, Bitboard occupied)
+{
+        Bitboard ray = rayTable[direction][square];
+        Bitboard blockers = ray & occupied;
+        if (!blockers)
+                return ray;
+
+        bool increasing = direction == SOUTH || direction == EAST || direction == SOUTH_EAST || direction == SOUTH_WEST;
+        int blocker = increasing ? lsb(blockers) : msb(blockers);
+        return ray ^ rayTable[direction][blocker];
+}
+
+Bitboard slowSliderAttacks(int square, Bitboard occupied, bool isBishop)
+{
+        if (isBishop)
+                return rayAttacks(square, NORTH_EAST, occupied) | rayAttacks(square, NORTH_WEST, occupied) |
+                       rayAttacks(square, SOUTH_EAST, occupied) | rayAttacks(square, SOUTH_WEST, occupied);
+
+        return rayAttacks(square, NORTH, occupied) | rayAttacks(square, SOUTH, occupied) |
+               rayAttacks(square, EAST, occupied) | rayAttacks(square, WEST, occupied);
+}
+
+// xorshift64*, reseeded per rank so that the magic search is deterministic
+uint64_t randomU64(uint64_t& state)
+{
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+}
+
+void initMagics(std::array<Magic, 64>& magics, Bitboard* table, bool isBishop)
+{
+        std::array<Bitboard, 4096> occupancies;
+        std::array<Bitboard, 4096> references;
+        std::array<int, 4096> epoch = {};
+        int attempt = 0;
+        uint64_t seed = 0;
+        Bitboard* attacks = table;
+
+        // Picked offline to keep the search for each rank short
+        const uint64_t magicSeeds[8] = {781, 1387, 250, 622, 939, 1320, 974, 30};
+
+        for (int square = 0; square < 64; square++)
+        {
+                Bitboard edges = ((RANK_1 | RANK_8) & ~(RANK_8 << (square / 8 * 8))) |
+                                 ((FILE_A | FILE_H) & ~(FILE_A << (square % 8)));
+
+                if (square % 8 == 0)
+                        seed = magicSeeds[square / 8];
+
+                Magic& m = magics[square];
+                m.mask = slowSliderAttacks(square, 0, isBishop) & ~edges;
+                m.shift = 64 - popCount(m.mask);
+                m.attacks = attacks;
+
+                // Enumerate all subsets of the mask (Carry-Rippler)
+                int size = 0;
+                Bitboard subset = 0;
+                do
+                {
+                        occupancies[size] = subset;
+                        references[size] = slowSliderAttacks(square, subset, isBishop);
+                        size++;
+                        subset = (subset - m.mask) & m.mask;
+                } while (subset);
+                attacks += size;
+
+#ifdef __BMI2__
+                for (int i = 0; i < size; i++)
+                        m.attacks[m.index(occupancies[i])] = references[i];
+#else
+                // Try sparse random candidates until one maps every subset without a harmful collision
+                bool found = false;
+                while (!found)
+                {
+                        do
+                        {
+                                m.magic = randomU64(seed) & randomU64(seed) & randomU64(seed);
+                        } while (popCount((m.mask * m.magic) >> 56) < 6);
+
+                        attempt++;
+                        found = true;
+                        for (int i = 0; i < size; i++)
+                        {
+                                unsigned index = m.index(occupancies[i]);
+                                if (epoch[index] < attempt)
+                                {
+                                        epoch[index] = attempt;
+                                        m.attacks[index] = references[i];
+                                }
+                                else if (m.attacks[index] != references[i])
+                                {
+                                        found = false;
+                                        break;
+                                }
+                        }
+                }
+#endif
+        }
+}
+
+void initBitboards()
+{
+        const int knightSteps[8][2] = {
+                {2, 1}, {2, -1}, {-2, 1}, {-2, -1},
+                {1, 2}, {1, -2}, {-1, 2}, {-1, -2}
+        };
+        const int kingSteps[8][2] = {
+                {1, 0}, {1, 1}, {0, 1}, {-1, 1},
+                {-1, 0}, {-1, -1}, {0, -1}, {1, -1}
+        };
+        const int whitePawnSteps[2][2] = {{-1, -1}, {-1, 1}};
+        const int blackPawnSteps[2][2] = {{1, -1}, {1, 1}};
+
+        for (int square = 0; square < 64; square++)
+        {
+                knightAttackTable[square] = stepAttacks(square, knightSteps, 8);
+                kingAttackTable[square] = stepAttacks(square, kingSteps, 8);
+                pawnAttackTable[WHITE][square] = stepAttacks(square, whitePawnSteps, 2);
+                pawnAttackTable[BLACK][square] = stepAttacks(square, blackPawnSteps, 2);
+
+                for (int direction = 0; direction < 8; direction++)
+                {
+                        Bitboard ray = 0;
+                        int rank = square / 8 + rayDirections[direction][0];
+                        int file = square % 8 + rayDirections[direction][1];
+                        while (rank >= 0 && rank < 8 && file >= 0 && file < 8)
+                        {
+                                ray |= squareBB(rank * 8 + file);
+                                rank += rayDirections[direction][0];
+                                file += rayDirections[direction][1];
+                        }
+                        rayTable[direction][square] = ray;
+                }
+        }
+
+        for (int from = 0; from < 64; from++)
+        {
+                betweenTable[from].fill(0);
+                lineTable[from].fill(0);
+                for (int direction = 0; direction < 8; direction++)
+                {
+                        Bitboard line = rayTable[direction][from] | rayTable[oppositeDirection[direction]][from] | squareBB(from);
+                        Bitboard ray = rayTable[direction][from];
+                        while (ray)
+                        {
+                                int to = popLSB(ray);
+                                betweenTable[from][to] = rayTable[direction][from] & ~rayTable[direction][to] & ~squareBB(to);
+                                lineTable[from][to] = line;
+                        }
+                }
+        }
+
+        initMagics(bishopMagics, bishopAttackTable.data(), true);
+        initMagics(rookMagics, rookAttackTable.data(), false);
+}
@@ -0,0 +1,141 @@
+#ifndef CHESS_BITBOARD_H
+#define CHESS_BITBOARD_H
+
+#include <array>
+#include <cstdint>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+typedef uint64_t Bitboard; // bit i is square i, 0 is a8, 63 is h1
+
+const Bitboard FILE_A = 0x0101010101010101ULL;
+const Bitboard FILE_B = FILE_A << 1;
+const Bitboard FILE_G = FILE_A << 6;
+const Bitboard FILE_H = FILE_A << 7;
+
+const Bitboard RANK_8 = 0xFFULL;
+const Bitboard RANK_7 = RANK_8 << 8;
+const Bitboard RANK_6 = RANK_8 << 16;
+const Bitboard RANK_3 = RANK_8 << 40;
+const Bitboard RANK_2 = RANK_8 << 48;
+const Bitboard RANK_1 = RANK_8 << 56;
+
+enum Side
+{
+        WHITE = 0,
+        BLACK = 1
+};
+
+inline Bitboard squareBB(int square)
+{
+        return 1ULL << square;
+}
+
+inline int popCount(Bitboard b)
+{
+        return __builtin_popcountll(b);
+}
+
+// b must not be empty
+inline int lsb(Bitboard b)
+{
+        return __builtin_ctzll(b);
+}
+
+// b must not be empty
+inline int msb(Bitboard b)
+{
+        return 63 - __builtin_clzll(b);
+}
+
+inline int popLSB(Bitboard& b)
+{
+        int square = lsb(b);
+        b &= b - 1;
+        return square;
+}
+
+// "north" is towards rank 8, which is towards square 0
+inline Bitboard shiftNorth(Bitboard b) { return b >> 8; }
+inline Bitboard shiftSouth(Bitboard b) { return b << 8; }
+inline Bitboard shiftEast(Bitboard b) { return (b << 1) & ~FILE_A; }
+inline Bitboard shiftWest(Bitboard b) { return (b >> 1) & ~FILE_H; }
+
+extern std::array<Bitboard, 64> knightAttackTable;
+extern std::array<Bitboard, 64> kingAttackTable;
+extern std::array<std::array<Bitboard, 64>, 2> pawnAttackTable; // indexed by Side
+extern std::array<std::array<Bitboard, 64>, 64> betweenTable;
+extern std::array<std::array<Bitboard, 64>, 64> lineTable;
+
+inline Bitboard knightAttacks(int square)
+{
+        return knightAttackTable[square];
+}
+
+inline Bitboard kingAttacks(int square)
+{
+        return kingAttackTable[square];
+}
+
+inline Bitboard pawnAttacks(int side, int square)
+{
+        return pawnAttackTable[side][square];
+}
+
+// Squares strictly between two squares on a common rank, file or diagonal, empty otherwise
+inline Bitboard betweenBB(int from, int to)
+{
+        return betweenTable[from][to];
+}
+
+// The whole rank, file or diagonal through two squares, empty if they are not aligned
+inline Bitboard lineBB(int a, int b)
+{
+        return lineTable[a][b];
+}
+
+// Slider attacks are looked up in tables indexed by the relevant occupancy, either
+// with a PEXT of the mask when compiled for BMI2 or with a magic multiplication
+struct Magic
+{
+        Bitboard mask;     // relevant occupancy, board edges excluded
+        Bitboard magic;
+        Bitboard* attacks; // 2^popCount(mask) entries
+        unsigned shift;
+
+        inline unsigned index(Bitboard occupied) const
+        {
+#ifdef __BMI2__
+                return (unsigned)_pext_u64(occupied, mask);
+#else
+                return (unsigned)(((occupied & mask) * magic) >> shift);
+#endif
+        }
+};
+
+extern std::array<Magic, 64> bishopMagics;
+extern std::array<Magic, 64> rookMagics;
+
+inline Bitboard bishopAttacks(int square, Bitboard occupied)
+{
+        const Magic& m = bishopMagics[square];
+        return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard rookAttacks(int square, Bitboard occupied)
+{
+        const Magic& m = rookMagics[square];
+        return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard queenAttacks(int square, Bitboard occupied)
+{
+        return bishopAttacks(square, occupied) | rookAttacks(square, occupied);
+}
+
+// must be called once before any attack lookup
+void initBitboards();
+
+#endif // CHESS_BITBOARD_H
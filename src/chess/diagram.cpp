@@ -0,0 +1,201 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "diagram.h"
+#include "fen.h"
+#include "../png.h"
+
+// Board coordinates run from -1 to 1 with y up, like the orthographic projection in reshapeWindow
+int toPixel(float coordinate, int size)
+{
+        return (int)std::lround((coordinate + 1.0f) / 2.0f * size);
+}
+
+unsigned char toByte(float channel)
+{
+        return (unsigned char)std::lround(channel * 255.0f);
+}
+
+void renderDiagram(const Board& board, const BoardState& boardState, const Image* sprites, int size, Image& out)
+{
+        out.width = size;
+        out.height = size;
+        out.channels = 3;
+        out.pixels.resize((size_t)size * size * 3);
+
+        for (int i = 0; i < 64; i++)
+        {
+                const Square& square = board.squares[i];
+                int left = toPixel(square.pos.x, size);
+                int right = toPixel(square.pos.x + square.size, size);
+                int top = toPixel(-square.pos.y, size);
+                int bottom = toPixel(-square.pos.y + square.size, size);
+                right = right < size ? right : size;
+                bottom = bottom < size ? bottom : size;
+
+                const unsigned char color[3] = {toByte(square.color.r), toByte(square.color.g), toByte(square.color.b)};
+                Piece piece = getPiece(boardState, i);
+                const Image* sprite = piece.type != NONE ? &sprites[piece.type - 1 + (piece.isWhite ? 0 : 6)] : nullptr;
+
+                for (int y = top; y < bottom; y++)
+                {
+                        unsigned char* pixel = &out.pixels[((size_t)y * size + left) * 3];
+                        for (int x = left; x < right; x++, pixel += 3)
+                        {
+                                pixel[0] = color[0];
+                                pixel[1] = color[1];
+                                pixel[2] = color[2];
+                                if (!sprite)
+                                        continue;
+
+                                // Nearest texel under the pixel center, alpha blended over the square
+                                int u = (int)((x - left + 0.5f) * sprite->width / (right - left));
+                                int v = (int)((y - top + 0.5f) * sprite->height / (bottom - top));
+                                const unsigned char* texel = &sprite->pixels[((size_t)v * sprite->width + u) * 4];
+                                unsigned alpha = texel[3];
+                                for (int c = 0; c < 3; c++)
+                                        pixel[c] = (unsigned char)((texel[c] * alpha + pixel[c] * (255 - alpha) + 127) / 255);
+                        }
+                }
+        }
+}
+
+void printRenderUsage(const char* program)
+{
+        std::cerr << "Usage: " << program << " render <size> <fen file> <output dir> [--threads <n, 0 for all cores>]\n";
+}
+
+int renderCommand(int argc, char** argv)
+{
+        int numThreads = (int)std::thread::hardware_concurrency();
+        int size = 0;
+        std::vector<std::string> args;
+        try
+        {
+                for (int i = 2; i < argc; i++)
+                {
+                        std::string arg = argv[i];
+                        if (arg == "--threads" && i + 1 < argc)
+                        {
+                                int value = std::stoi(argv[++i]);
+                                numThreads = value > 0 ? value : (int)std::thread::hardware_concurrency();
+                        }
+                        else
+                        {
+                                args.push_back(arg);
+                        }
+                }
+                if (!args.empty())
+                        size = std::stoi(args[0]);
+        }
+        catch (const std::invalid_argument& e)
+        {
+                printRenderUsage(argv[0]);
+                return -1;
+        }
+        catch (const std::out_of_range& e)
+        {
+                printRenderUsage(argv[0]);
+                return -1;
+        }
+
+        if (args.size() < 3)
+        {
+                printRenderUsage(argv[0]);
+                return -1;
+        }
+        numThreads = numThreads > 0 ? numThreads : 1;
+
+        // Also keeps size * size * channels far from overflowing before the pixel buffer is allocated
+        if (size < 8 || size > 16384)
+        {
+                std::cerr << "Image size must be between 8 and 16384 pixels\n";
+                return -1;
+        }
+
+        std::ifstream fenFile(args[1]);
+        if (!fenFile)
+        {
+                std::cerr << "Failed to open " << args[1] << "\n";
+                return -1;
+        }
+        std::vector<std::string> fens;
+        std::string line;
+        while (std::getline(fenFile, line))
+        {
+                if (!line.empty())
+                        fens.push_back(line);
+        }
+
+        std::string outputDir = args[2];
+        std::error_code error;
+        std::filesystem::create_directories(outputDir, error);
+        if (error)
+        {
+                std::cerr << "Failed to create " << outputDir << ": " << error.message() << "\n";
+                return -1;
+        }
+
+        Image sprites[12];
+        if (loadPieceImages(sprites) != 0)
+                return -1;
+
+        Board board = generateBoard(size, size, false, lightSquareColor, darkSquareColor);
+
+        // Positions are handed out one at a time so slow disks do not leave threads idle
+        std::atomic<size_t> next{0};
+        std::atomic<int> failed{0};
+        std::atomic<uint64_t> bytesWritten{0};
+        auto renderWorker = [&]()
+        {
+                Image image;
+                BoardState boardState;
+                std::error_code sizeError;
+                size_t index;
+                while ((index = next++) < fens.size())
+                {
+                        if (applyFEN(fens[index], boardState) != 0)
+                        {
+                                std::cerr << "Error parsing FEN on line " << index + 1 << "\n";
+                                failed++;
+                                continue;
+                        }
+
+                        renderDiagram(board, boardState, sprites, size, image);
+
+                        char name[32];
+                        snprintf(name, sizeof(name), "/%05zu.png", index + 1);
+                        std::string path = outputDir + name;
+                        if (writePNG(path, image) != 0)
+                        {
+                                failed++;
+                                continue;
+                        }
+                        bytesWritten += std::filesystem::file_size(path, sizeError);
+                }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < numThreads; i++)
+                threads.emplace_back(renderWorker);
+        for (std::thread& thread : threads)
+                thread.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t rendered = fens.size() - failed;
+        std::cout << "Rendered " << rendered << " images of " << size << "x" << size << " with " << numThreads
+                  << " threads in " << seconds << " s\n";
+        std::cout << "Images/sec: " << rendered / (seconds > 0.0 ? seconds : 1e-9) << "\n";
+        std::cout << "Average size: " << (rendered ? bytesWritten / rendered / 1024 : 0) << " KiB\n";
+        return failed ? -1 : 0;
+}
@@ -0,0 +1,14 @@
+#ifndef CHESS_DIAGRAM_H
+#define CHESS_DIAGRAM_H
+
+#include "gamestate.h"
+#include "../texture.h"
+
+// CPU version of drawBoard: same squares, colors and nearest-sampled sprites, no GL context needed.
+// sprites holds the 12 piece images from loadPieceImages.
+void renderDiagram(const Board& board, const BoardState& boardState, const Image* sprites, int size, Image& out);
+
+// render <size> <fen file> <output dir> [--threads <n>], writes one PNG per FEN line
+int renderCommand(int argc, char** argv);
+
+#endif // CHESS_DIAGRAM_H
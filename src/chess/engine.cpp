@@ -0,0 +1,104 @@
+#include <iostream>
+
+#include "engine.h"
+#include "movement.h"
+#include "../profiler.h"
+
+void publishSnapshot(EngineWorker& engine, const BoardState& boardState, const PositionCache& position, Move lastMove)
+{
+        PositionSnapshot snapshot;
+        snapshot.boardState = boardState;
+        snapshot.legalMoves = position.legalMoves;
+        snapshot.gameState = position.gameState;
+        snapshot.lastMove = lastMove;
+
+        Bitboard king = boardState.pieceBB[KING] & boardState.colorBB[boardState.isWhiteTurn ? WHITE : BLACK];
+        if (king && isSquareAttacked(boardState, lsb(king), !boardState.isWhiteTurn))
+                snapshot.checkedKing = king;
+
+        // The UI drains the queue every time it wakes, so a full queue only lasts a moment.
+        // Once stopping nobody drains it any more, so the snapshot is dropped instead.
+        while (!engine.results.push(snapshot))
+        {
+                if (engine.stopping.load(std::memory_order_relaxed))
+                        return;
+                std::this_thread::yield();
+        }
+
+        if (engine.onResult)
+                engine.onResult();
+}
+
+void runEngine(EngineWorker& engine, BoardState boardState)
+{
+        UndoStack history;
+        PositionCache position;
+        updatePositionCache(position, boardState);
+        publishSnapshot(engine, boardState, position, MOVE_NONE);
+
+        while (true)
+        {
+                EngineCommand command;
+                if (!engine.commands.pop(command))
+                {
+                        std::unique_lock<std::mutex> lock(engine.mutex);
+                        engine.wake.wait(lock, [&engine] { return !engine.commands.empty(); });
+                        continue;
+                }
+
+                switch (command.type)
+                {
+                        case ENGINE_MOVE:
+                        {
+                                PROFILE_SCOPE("engine move");
+                                Move move = findMove(position.legalMoves, command.from, command.to);
+                                movePiece(boardState, position.legalMoves, history, command.from, command.to);
+                                if (updatePositionCache(position, boardState))
+                                        publishSnapshot(engine, boardState, position, move);
+                                break;
+                        }
+                        case ENGINE_QUIT:
+                                return;
+                }
+        }
+}
+
+void startEngine(EngineWorker& engine, const BoardState& boardState, void (*onResult)())
+{
+        engine.onResult = onResult;
+        engine.stopping.store(false, std::memory_order_relaxed);
+        engine.thread = std::thread(runEngine, std::ref(engine), boardState);
+}
+
+void stopEngine(EngineWorker& engine)
+{
+        if (!engine.thread.joinable())
+                return;
+
+        engine.stopping.store(true, std::memory_order_relaxed);
+        while (!postEngineCommand(engine, {ENGINE_QUIT, -1, -1}))
+                std::this_thread::yield();
+        engine.thread.join();
+}
+
+bool postEngineCommand(EngineWorker& engine, const EngineCommand& command)
+{
+        if (!engine.commands.push(command))
+                return false;
+
+        // Taking the lock orders the push before the worker's emptiness check, so the wakeup cannot be lost
+        {
+                std::lock_guard<std::mutex> lock(engine.mutex);
+        }
+        engine.wake.notify_one();
+        return true;
+}
+
+bool pollEngineResult(EngineWorker& engine, PositionSnapshot& snapshot)
+{
+        PROFILE_SCOPE("pollEngineResult");
+        bool received = false;
+        while (engine.results.pop(snapshot))
+                received = true;
+        return received;
+}
@@ -0,0 +1,58 @@
+#ifndef CHESS_ENGINE_H
+#define CHESS_ENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "gamestate.h"
+#include "move.h"
+#include "spscqueue.h"
+
+// A copy of the engine's position, published after every change. The UI only reads it.
+struct PositionSnapshot
+{
+        BoardState boardState;
+        MoveList legalMoves;
+        int gameState = CONTINUE;
+        Move lastMove = MOVE_NONE;
+        Bitboard checkedKing = 0; // the side to move's king if it is in check
+};
+
+enum EngineCommandType
+{
+        ENGINE_MOVE = 0,
+        ENGINE_QUIT
+};
+
+struct EngineCommand
+{
+        EngineCommandType type;
+        int from;
+        int to;
+};
+
+// The worker thread owns the game position. The UI thread posts commands and polls
+// snapshots, both through lock-free queues. The mutex is only used to park the worker
+// while it has nothing to do.
+struct EngineWorker
+{
+        SPSCQueue<EngineCommand, 64> commands;
+        SPSCQueue<PositionSnapshot, 16> results;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::atomic<bool> stopping{false}; // set by stopEngine, makes the worker drop pending snapshots
+        void (*onResult)() = nullptr; // called on the worker thread after a snapshot is published
+};
+
+// Publishes a snapshot of boardState as soon as the worker is running
+void startEngine(EngineWorker& engine, const BoardState& boardState, void (*onResult)());
+void stopEngine(EngineWorker& engine);
+// Returns false if the command queue is full
+bool postEngineCommand(EngineWorker& engine, const EngineCommand& command);
+// Takes the most recent snapshot, returns false if none was published since the last call
+bool pollEngineResult(EngineWorker& engine, PositionSnapshot& snapshot);
+
+#endif // CHESS_ENGINE_H
@@ -3,11 +3,12 @@
 
 #include "movement.h"
 #include "gamestate.h"
+#include "zobrist.h"
 
 int applyFEN(const std::string& fen, BoardState& boardState)
 {
         int numKings = 0;
-        boardState.pieces.fill({NONE, false}); // Clear the board
+        clearPieces(boardState);
 
         size_t fenIndex = 0;
         int boardIndex = 0;
@@ -43,7 +44,7 @@ int applyFEN(const std::string& fen, BoardState& boardState)
                                 default: return -1; // Invalid character
                         }
                         piece.isWhite = isupper(c);
-                        boardState.pieces[boardIndex++] = piece;
+                        putPiece(boardState, boardIndex++, piece);
                 }
         }
 
@@ -60,6 +61,7 @@ int applyFEN(const std::string& fen, BoardState& boardState)
                 boardState.enPassantSquare = -1;
                 boardState.halfMoveClock = 0;
                 boardState.fullMoveClock = 1;
+                boardState.hash = computeHash(boardState);
                 return 0;
         }
 
@@ -77,7 +79,7 @@ int applyFEN(const std::string& fen, BoardState& boardState)
 
         // castling availability
         std::string castlingAvailability = "";
-        while (fen[fenIndex] != ' ')
+        while (fenIndex < fen.size() && fen[fenIndex] != ' ')
         {
                 castlingAvailability += fen[fenIndex];
                 fenIndex++;
@@ -102,20 +104,28 @@ int applyFEN(const std::string& fen, BoardState& boardState)
         fenIndex++;
 
         // en passant target square
+        if (fenIndex >= fen.size())
+                return -1;
         if (fen[fenIndex] == '-')
+        {
                 boardState.enPassantSquare = -1;
+                fenIndex += 2;
+        }
         else
         {
+                if (fenIndex + 1 >= fen.size())
+                        return -1;
                 int file = fen[fenIndex] - 'a';
                 int rank = fen[fenIndex + 1] - '1';
-                boardState.enPassantSquare = rank * 8 + file;
+                if (file < 0 || file > 7 || rank < 0 || rank > 7)
+                        return -1;
+                boardState.enPassantSquare = (7 - rank) * 8 + file; // square 0 is a8
+                fenIndex += 3;
         }
 
-        fenIndex += 2;
-
         // halfmove and fullmove clock
         std::string halfMoveClock = "";
-        while (fen[fenIndex] != ' ')
+        while (fenIndex < fen.size() && fen[fenIndex] != ' ')
         {
                 halfMoveClock += fen[fenIndex];
                 fenIndex++;
@@ -123,12 +133,18 @@ int applyFEN(const std::string& fen, BoardState& boardState)
 
         fenIndex++; // Skip space
         std::string fullMoveClock = "";
-        while (fen[fenIndex] != ' ')
+        while (fenIndex < fen.size() && fen[fenIndex] != ' ')
         {
                 fullMoveClock += fen[fenIndex];
                 fenIndex++;
         }
 
+        // The clocks are often left out, e.g. in EPD test suites
+        if (halfMoveClock.empty())
+                halfMoveClock = "0";
+        if (fullMoveClock.empty())
+                fullMoveClock = "1";
+
         try
         {
                 boardState.halfMoveClock = std::stoi(halfMoveClock);
@@ -139,8 +155,7 @@ int applyFEN(const std::string& fen, BoardState& boardState)
                 return -1;
         }
 
-        generatePossibleMoves(boardState);
-
+        boardState.hash = computeHash(boardState);
         return 0;
 }
 
@@ -2,43 +2,22 @@
 
 #include "gamestate.h"
 #include "../gui.h"
+#include "../texture.h"
 #include "gui.h"
+#include "engine.h"
 #include "movement.h"
+#include "../profiler.h"
 
 void printBoardState(const BoardState& boardState)
 {
+        const char pieceChars[7] = {' ', 'p', 'n', 'b', 'r', 'q', 'k'};
         for (int i = 0; i < 64; i++)
         {
                 if (i % 8 == 0)
                         std::cout << "\n";
-                if (boardState.pieces[i].type == NONE)
-                        std::cout << " ";
-                else if (boardState.pieces[i].type == PAWN && boardState.pieces[i].isWhite)
-                        std::cout << "P";
-                else if (boardState.pieces[i].type == KNIGHT && boardState.pieces[i].isWhite)
-                        std::cout << "N";
-                else if (boardState.pieces[i].type == BISHOP && boardState.pieces[i].isWhite)
-                        std::cout << "B";
-                else if (boardState.pieces[i].type == ROOK && boardState.pieces[i].isWhite)
-                        std::cout << "R";
-                else if (boardState.pieces[i].type == QUEEN && boardState.pieces[i].isWhite)
-                        std::cout << "Q";
-                else if (boardState.pieces[i].type == KING && boardState.pieces[i].isWhite)
-                        std::cout << "K";
-                else if (boardState.pieces[i].type == PAWN)
-                        std::cout << "p";
-                else if (boardState.pieces[i].type == KNIGHT)
-                        std::cout << "n";
-                else if (boardState.pieces[i].type == BISHOP)
-                        std::cout << "b";
-                else if (boardState.pieces[i].type == ROOK)
-                        std::cout << "r";
-                else if (boardState.pieces[i].type == QUEEN)
-                        std::cout << "q";
-                else if (boardState.pieces[i].type == KING)
-                        std::cout << "k";
-                else
-                        std::cout << "?";
+                Piece piece = getPiece(boardState, i);
+                char c = pieceChars[piece.type];
+                std::cout << (char)(piece.isWhite ? toupper(c) : c);
         }
         std::cout << "\n";
         std::cout << "Turn: " << (boardState.isWhiteTurn ? "White" : "Black") << "\n";
@@ -55,12 +34,12 @@ void printBoardState(const BoardState& boardState)
         std::cout << "\n";
 }
 
-void printAvailableMoves(const BoardState& boardState, int from)
+void printAvailableMoves(const MoveList& moves, int from)
 {
         std::cout << "Available moves for piece at " << from << ": \n";
         for (int i = 0; i < 64; i++)
         {
-                std::cout << (boardState.canMoveTo[from][i] ? i : -1) << " ";
+                std::cout << (findMove(moves, from, i) != MOVE_NONE ? i : -1) << " ";
                 if (i % 8 == 7)
                         std::cout << "\n";
         }
@@ -78,16 +57,27 @@ Board generateBoard(int width, int height, bool isBlackPersp, Color whiteColor,
 
         board.whiteColor = whiteColor;
         board.blackColor = blackColor;
+        board.origin = {-1.0f, 1.0f};
+        board.squareSize = sqrWidth;
+        board.isBlackPersp = isBlackPersp;
+        board.highlights.fill(0);
+        board.highlightColors[HIGHLIGHT_LAST_MOVE] = {0.9f, 0.8f, 0.3f};
+        board.highlightColors[HIGHLIGHT_ENGINE] = {0.2f, 0.5f, 0.9f};
+        board.highlightColors[HIGHLIGHT_LEGAL_MOVES] = {0.8f, 0.2f, 0.2f};
+        board.highlightColors[HIGHLIGHT_CHECK] = {1.0f, 0.0f, 0.0f};
+        board.dirtySquares = ~0ULL;
 
         for (int i = 0; i < 8; i++)
         {
                 for (int j = 0; j < 8; j++)
                 {
                         int index = i * 8 + j;
-                        board.squares[index].pos.x = -1.0f + j * sqrWidth;
-                        board.squares[index].pos.y = 1.0f - i * sqrWidth;
+                        int row = isBlackPersp ? 7 - i : i;
+                        int column = isBlackPersp ? 7 - j : j;
+                        board.squares[index].pos.x = board.origin.x + column * sqrWidth;
+                        board.squares[index].pos.y = board.origin.y - row * sqrWidth;
                         board.squares[index].size = sqrWidth;
-                        if ((i + j) % 2 == isBlackPersp)
+                        if ((i + j) % 2 == 0)
                                 board.squares[index].color = whiteColor;
                         else
                                 board.squares[index].color = blackColor;
@@ -97,8 +87,7 @@ Board generateBoard(int width, int height, bool isBlackPersp, Color whiteColor,
         return board;
 }
 
-const std::string pieceTextures[13] = {
-        "dummy",
+const std::string pieceTextures[12] = {
         "resources/white-pawn.png",
         "resources/white-knight.png",
         "resources/white-bishop.png",
@@ -113,57 +102,79 @@ const std::string pieceTextures[13] = {
         "resources/black-king.png"
 };
 
-void drawBoard(const Board& board, const BoardState& boardState)
+void startLoadingPieceImages(ImageLoader& loader, void (*onDone)())
 {
-        for (int i = 0; i < 64; i++)
+        startImageLoader(loader, pieceTextures, 12, onDone);
+}
+
+int loadPieceTextures(TextureCache& cache, TextureAtlas& atlas, const Image* images)
+{
+        if (buildAtlas(cache, atlas, images, 12, 6) != 0)
+                return -1;
+
+        printTextureStats(cache);
+        return 0;
+}
+
+int loadPieceImages(Image* images)
+{
+        for (int i = 0; i < 12; i++)
         {
-                drawSquare(board.squares[i], 0);
-                int type = boardState.pieces[i].type;
-                if (type != NONE)
-                {
-                        drawTexture(board.squares[i], 1, pieceTextures[type + (boardState.pieces[i].isWhite ? 0 : 6)]);
-                }
+                if (loadImage(pieceTextures[i], images[i]) != 0)
+                        return -1;
         }
+        return 0;
 }
 
-int checkGameState(const BoardState& boardState)
+void drawBoard(Board& board, const BoardState& boardState, const Renderer& renderer, BoardLayers& layers, const TextureCache& textures, const TextureAtlas& atlas)
 {
-        bool availableMoves = false;
-        for (int i = 0; i < 64; i++)
+        PROFILE_SCOPE("drawBoard");
+        const AtlasRect wholeTexture = {0.0f, 0.0f, 1.0f, 1.0f};
+        const Color pieceTint = {1.0f, 1.0f, 1.0f};
+
+        Bitboard recolored = updateSquareColors(board);
+        while (recolored)
         {
-                if (boardState.pieces[i].isWhite == boardState.isWhiteTurn)
-                {
-                        for (int j = 0; j < 64; j++)
-                        {
-                                if (boardState.canMoveTo[i][j])
-                                {
-                                        availableMoves = true;
-                                        break;
-                                }
-                        }
-                }
-                if (availableMoves)
-                        break;
+                int i = popLSB(recolored);
+                const Square& square = board.squares[i];
+                setQuad(layers.squares, i, square.pos, square.size, 0, square.color, wholeTexture);
         }
 
-        bool kingInCheck = false;
+        // Only quads whose piece changed are uploaded again
+        bool placeholders = atlas.rects.empty();
         for (int i = 0; i < 64; i++)
         {
-                if (boardState.pieces[i].type == KING && boardState.pieces[i].isWhite == boardState.isWhiteTurn)
+                const Square& square = board.squares[i];
+                Piece piece = getPiece(boardState, i);
+                if (piece.type == NONE)
+                {
+                        hideQuad(layers.pieces, i);
+                }
+                else if (placeholders)
                 {
-                        for (int j = 0; j < 64; j++)
-                        {
-                                if (boardState.canMoveTo[j][i] && boardState.pieces[j].isWhite != boardState.isWhiteTurn)
-                                {
-                                        kingInCheck = true;
-                                        break;
-                                }
-                        }
+                        const Color tileColors[2] = {{0.85f, 0.85f, 0.85f}, {0.1f, 0.1f, 0.1f}};
+                        float inset = square.size / 4;
+                        setQuad(layers.pieces, i, {square.pos.x + inset, square.pos.y - inset}, square.size / 2, 1,
+                                tileColors[piece.isWhite ? 0 : 1], wholeTexture);
+                }
+                else
+                {
+                        setQuad(layers.pieces, i, square.pos, square.size, 1, pieceTint, atlas.rects[piece.type - 1 + (piece.isWhite ? 0 : 6)]);
                 }
-                if (kingInCheck)
-                        break;
         }
 
+        layers.pieces.texture = placeholders ? 0 : atlasTexture(textures, atlas);
+        drawQuadLayer(renderer, layers.squares);
+        drawQuadLayer(renderer, layers.pieces);
+}
+
+int checkGameState(const BoardState& boardState, const MoveList& legalMoves)
+{
+        bool availableMoves = legalMoves.count > 0;
+
+        Bitboard kingBB = boardState.pieceBB[KING] & boardState.colorBB[boardState.isWhiteTurn ? WHITE : BLACK];
+        bool kingInCheck = kingBB && isSquareAttacked(boardState, lsb(kingBB), !boardState.isWhiteTurn);
+
         if (kingInCheck && !availableMoves)
         {
                 return CHECKMATE;
@@ -176,31 +187,37 @@ int checkGameState(const BoardState& boardState)
         return CONTINUE;
 }
 
-void processInput(GLFWwindow* window, BoardState& boardState, Board& board, double& prevXpos, double& prevYpos, bool& isMovingPiece)
+bool processInput(GLFWwindow* window, const CursorMapping& cursor, const PositionSnapshot& position, EngineWorker& engine, Board& board, double& prevXpos, double& prevYpos, bool& isMovingPiece)
 {
+        PROFILE_SCOPE("processInput");
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
                 glfwSetWindowShouldClose(window, true);
 
+        bool changed = false;
+
         if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS && !isMovingPiece)
         {
                 glfwGetCursorPos(window, &prevXpos, &prevYpos);
-                convertToOpenGLCoords(prevXpos, prevYpos, window);
-                int from = getSquareIndexAtPostition(prevXpos, prevYpos, window, board);
-                generatePossibleMoves(boardState);
-                eliminateCheckMoves(boardState, from);
-                colorPossibleMoves(board, boardState, from);
-                //printAvailableMoves(boardState, from);
+                cursorToOpenGL(cursor, prevXpos, prevYpos);
+                int from = getSquareIndexAtPostition(prevXpos, prevYpos, board);
+                colorPossibleMoves(board, position.boardState, position.legalMoves, from);
+                //printAvailableMoves(position.legalMoves, from);
                 isMovingPiece = true;
+                changed = true;
         }
         else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_RELEASE && isMovingPiece)
         {
                 double xpos, ypos;
                 glfwGetCursorPos(window, &xpos, &ypos);
-                convertToOpenGLCoords(xpos, ypos, window);
-                int from = getSquareIndexAtPostition(prevXpos, prevYpos, window, board);
-                int to = getSquareIndexAtPostition(xpos, ypos, window, board);
-                movePiece(boardState, board, from, to);
+                cursorToOpenGL(cursor, xpos, ypos);
+                int from = getSquareIndexAtPostition(prevXpos, prevYpos, board);
+                int to = getSquareIndexAtPostition(xpos, ypos, board);
+                if (!postEngineCommand(engine, {ENGINE_MOVE, from, to}))
+                        std::cerr << "Engine is busy, move dropped\n";
                 recolorBoard(board);
                 isMovingPiece = false;
+                changed = true;
         }
+
+        return changed;
 }
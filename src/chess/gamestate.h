@@ -7,12 +7,51 @@
 #include <cstdint>
 
 #include "../datatypes.h"
+#include "../renderer.h"
+#include "bitboard.h"
+
+struct MoveList;
+struct UndoStack;
+struct TextureCache;
+struct TextureAtlas;
+struct Image;
+struct ImageLoader;
+struct PositionSnapshot;
+struct EngineWorker;
+struct CursorMapping;
+
+const Color lightSquareColor = {1.f, 1.f, 1.f};
+const Color darkSquareColor = {0.34f, 0.2f, 0.2f};
+
+// Square colors are drawn first, then the pieces, each layer holds one quad per square
+struct BoardLayers
+{
+        QuadLayer squares;
+        QuadLayer pieces;
+};
+
+// Higher layers are drawn over lower ones where they overlap
+enum HighlightLayer
+{
+        HIGHLIGHT_LAST_MOVE = 0,
+        HIGHLIGHT_ENGINE,
+        HIGHLIGHT_LEGAL_MOVES,
+        HIGHLIGHT_CHECK,
+        HIGHLIGHT_LAYERS
+};
 
 struct Board
 {
         Color whiteColor;
         Color blackColor;
         std::array<Square, 64> squares; // 0 is a8, 63 is h1
+        Vector2f origin;                // top left corner of the board on screen
+        float squareSize;
+        bool isBlackPersp;              // h1 in the top left corner instead of a8
+
+        std::array<Bitboard, HIGHLIGHT_LAYERS> highlights;
+        std::array<Color, HIGHLIGHT_LAYERS> highlightColors; // mixed half and half with the square color
+        Bitboard dirtySquares;                               // squares whose color has to be recomputed
 };
 
 enum PieceType
@@ -34,6 +73,10 @@ struct Piece
 
 struct BoardState
 {
+        std::array<Bitboard, 7> pieceBB; // one board per PieceType, pieceBB[NONE] is unused
+        std::array<Bitboard, 2> colorBB; // indexed by Side
+        Bitboard occupied;
+
         bool isWhiteTurn;
         bool whiteCanCastleKingside;
         bool whiteCanCastleQueenside;
@@ -45,10 +88,64 @@ struct BoardState
         int halfMoveClock;
         int fullMoveClock;
 
-        std::array<Piece, 64> pieces; // 0 is a8, 63 is h1
-        std::array<std::array<bool, 64>, 64> canMoveTo; // array of possible moves for each piece
+        uint64_t hash; // Zobrist key, set by applyFEN and kept up to date by makeMove
 };
 
+static_assert(sizeof(BoardState) <= 128, "BoardState should stay within two cache lines");
+
+inline Piece getPiece(const BoardState& boardState, int square)
+{
+        Bitboard bit = squareBB(square);
+        Piece piece = {NONE, false};
+        if (!(boardState.occupied & bit))
+                return piece;
+
+        piece.isWhite = (boardState.colorBB[WHITE] & bit) != 0;
+        for (uint8_t type = PAWN; type <= KING; type++)
+        {
+                if (boardState.pieceBB[type] & bit)
+                {
+                        piece.type = type;
+                        break;
+                }
+        }
+        return piece;
+}
+
+inline void putPiece(BoardState& boardState, int square, Piece piece)
+{
+        Bitboard bit = squareBB(square);
+        boardState.pieceBB[piece.type] |= bit;
+        boardState.colorBB[piece.isWhite ? WHITE : BLACK] |= bit;
+        boardState.occupied |= bit;
+}
+
+inline void removePiece(BoardState& boardState, int square)
+{
+        Bitboard mask = ~squareBB(square);
+        for (int type = PAWN; type <= KING; type++)
+                boardState.pieceBB[type] &= mask;
+        boardState.colorBB[WHITE] &= mask;
+        boardState.colorBB[BLACK] &= mask;
+        boardState.occupied &= mask;
+}
+
+// Faster than removePiece(boardState, square) when the piece is known
+inline void removePiece(BoardState& boardState, int square, Piece piece)
+{
+        Bitboard mask = ~squareBB(square);
+        boardState.pieceBB[piece.type] &= mask;
+        boardState.colorBB[piece.isWhite ? WHITE : BLACK] &= mask;
+        boardState.occupied &= mask;
+}
+
+inline void clearPieces(BoardState& boardState)
+{
+        boardState.pieceBB.fill(0);
+        boardState.colorBB.fill(0);
+        boardState.occupied = 0;
+}
+
 enum GameState
 {
         CONTINUE = 0,
@@ -57,10 +154,19 @@ enum GameState
 };
 
 void printBoardState(const BoardState& boardState);
-void printAvailableMoves(const BoardState& boardState, int from);
+void printAvailableMoves(const MoveList& moves, int from);
 Board generateBoard(int width, int height, bool isBlackPersp, Color whiteColor, Color blackColor);
-void drawBoard(const Board& board, const BoardState& boardState);
-int checkGameState(const BoardState& boardState);
-void processInput(GLFWwindow* window, BoardState& boardState, Board& board, double& prevXpos, double& prevYpos, bool& isMovingPiece);
+// Decodes the 12 piece images in the background, onDone is called on a worker thread
+void startLoadingPieceImages(ImageLoader& loader, void (*onDone)());
+// Packs the decoded piece images into an atlas, white pieces on the first row in PieceType order
+int loadPieceTextures(TextureCache& cache, TextureAtlas& atlas, const Image* images);
+// Same order as the atlas, images must hold 12 entries
+int loadPieceImages(Image* images);
+// Recolors the dirty squares, then uploads only those to the square layer.
+// Pieces are drawn as plain tiles while the atlas is still empty.
+void drawBoard(Board& board, const BoardState& boardState, const Renderer& renderer, BoardLayers& layers, const TextureCache& textures, const TextureAtlas& atlas);
+int checkGameState(const BoardState& boardState, const MoveList& legalMoves);
+// Moves are posted to the engine, returns true if the board needs to be redrawn
+bool processInput(GLFWwindow* window, const CursorMapping& cursor, const PositionSnapshot& position, EngineWorker& engine, Board& board, double& prevXpos, double& prevYpos, bool& isMovingPiece);
 
 #endif // CHESS_GAMESTATE_H
@@ -1,64 +1,76 @@
+#include <cmath>
+
 #include "gamestate.h"
+#include "move.h"
 #include "../datatypes.h"
 
-void colorPossibleMoves(Board& board, const BoardState& boardState, int from)
-{
-        if (boardState.pieces[from].type == NONE)
-                return;
-        if (boardState.pieces[from].isWhite != boardState.isWhiteTurn)
-                return;
-
-        Color highlightColor = {0.8f, 0.2f, 0.2f};
+// a8 is a light square
+const Bitboard LIGHT_SQUARES = 0xAA55AA55AA55AA55ULL;
 
-        Color colorMixedWhite = {
-                (board.whiteColor.r + highlightColor.r) / 2,
-                (board.whiteColor.g + highlightColor.g) / 2,
-                (board.whiteColor.b + highlightColor.b) / 2
-        };
+void setHighlight(Board& board, HighlightLayer layer, Bitboard squares)
+{
+        board.dirtySquares |= board.highlights[layer] ^ squares;
+        board.highlights[layer] = squares;
+}
 
-        Color colorMixedBlack = {
-                (board.blackColor.r + highlightColor.r) / 2,
-                (board.blackColor.g + highlightColor.g) / 2,
-                (board.blackColor.b + highlightColor.b) / 2
-        };
+Bitboard updateSquareColors(Board& board)
+{
+        Bitboard dirty = board.dirtySquares;
+        board.dirtySquares = 0;
 
-        for (int i = 0; i < 64; i++)
+        Bitboard squares = dirty;
+        while (squares)
         {
-                if (boardState.canMoveTo[from][i])
-                {
-                        if ((i / 8 + i % 8) % 2 == 0)
-                                board.squares[i].color = colorMixedWhite;
-                        else
-                                board.squares[i].color = colorMixedBlack;
-                }
-                else
+                int i = popLSB(squares);
+                Color base = LIGHT_SQUARES & squareBB(i) ? board.whiteColor : board.blackColor;
+                Color color = base;
+                for (int layer = HIGHLIGHT_LAYERS - 1; layer >= 0; layer--)
                 {
-                        if ((i / 8 + i % 8) % 2 == 0)
-                                board.squares[i].color = board.whiteColor;
-                        else
-                                board.squares[i].color = board.blackColor;
+                        if (board.highlights[layer] & squareBB(i))
+                        {
+                                const Color& highlight = board.highlightColors[layer];
+                                color = {(base.r + highlight.r) / 2, (base.g + highlight.g) / 2, (base.b + highlight.b) / 2};
+                                break;
+                        }
                 }
+                board.squares[i].color = color;
         }
+
+        return dirty;
 }
 
-void recolorBoard(Board& board)
+void colorPossibleMoves(Board& board, const BoardState& boardState, const MoveList& moves, int from)
 {
-        for (int i = 0; i < 64; i++)
+        if (from == -1)
+                return;
+        Piece piece = getPiece(boardState, from);
+        if (piece.type == NONE)
+                return;
+        if (piece.isWhite != boardState.isWhiteTurn)
+                return;
+
+        Bitboard targets = 0;
+        for (Move move : moves)
         {
-                if ((i / 8 + i % 8) % 2 == 0)
-                        board.squares[i].color = board.whiteColor;
-                else
-                        board.squares[i].color = board.blackColor;
+                if (moveFrom(move) == from)
+                        targets |= squareBB(moveTo(move));
         }
+
+        setHighlight(board, HIGHLIGHT_LEGAL_MOVES, targets);
+}
+
+void recolorBoard(Board& board)
+{
+        setHighlight(board, HIGHLIGHT_LEGAL_MOVES, 0);
 }
 
-int getSquareIndexAtPostition(float x, float y, GLFWwindow* window, const Board& board)
+int getSquareIndexAtPostition(float x, float y, const Board& board)
 {
-        for (int i = 0; i < 64; i++)
-        {
-                Square square = board.squares[i];
-                if (square.in(x, y))
-                        return i;
-        }
-        return -1;
+        int column = (int)std::floor((x - board.origin.x) / board.squareSize);
+        int row = (int)std::floor((board.origin.y - y) / board.squareSize);
+        if (column < 0 || column > 7 || row < 0 || row > 7)
+                return -1;
+
+        int index = row * 8 + column;
+        return board.isBlackPersp ? 63 - index : index;
 }
@@ -4,9 +4,16 @@
 #include <GLFW/glfw3.h>
 
 #include "gamestate.h"
+#include "move.h"
 
-void colorPossibleMoves(Board& board, const BoardState& boardState, int from);
+void setHighlight(Board& board, HighlightLayer layer, Bitboard squares);
+// Recomputes the colors of the dirty squares and returns them
+Bitboard updateSquareColors(Board& board);
+// Highlight the legal targets of the piece on from
+void colorPossibleMoves(Board& board, const BoardState& boardState, const MoveList& moves, int from);
+// Clears the legal move highlight
 void recolorBoard(Board& board);
-int getSquareIndexAtPostition(float x, float y, GLFWwindow* window, const Board& board);
+// x and y in OpenGL coordinates, returns -1 outside the board
+int getSquareIndexAtPostition(float x, float y, const Board& board);
 
 #endif // CHESS_GUI_H
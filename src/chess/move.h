@@ -0,0 +1,91 @@
+#ifndef CHESS_MOVE_H
+#define CHESS_MOVE_H
+
+#include <array>
+#include <cstdint>
+
+#include "gamestate.h"
+
+// bits 0-5 from square, bits 6-11 to square, bits 12-15 MoveFlag
+typedef uint16_t Move;
+
+const Move MOVE_NONE = 0;
+
+enum MoveFlag
+{
+        MOVE_QUIET = 0,
+        MOVE_DOUBLE_PUSH = 1,
+        MOVE_KING_CASTLE = 2,
+        MOVE_QUEEN_CASTLE = 3,
+        MOVE_CAPTURE = 4,
+        MOVE_EN_PASSANT = 5,
+        MOVE_PROMOTION = 8,          // low two bits select knight, bishop, rook or queen
+        MOVE_PROMOTION_CAPTURE = 12
+};
+
+inline Move encodeMove(int from, int to, int flags)
+{
+        return (Move)(from | (to << 6) | (flags << 12));
+}
+
+inline int moveFrom(Move move)
+{
+        return move & 63;
+}
+
+inline int moveTo(Move move)
+{
+        return (move >> 6) & 63;
+}
+
+inline int moveFlags(Move move)
+{
+        return move >> 12;
+}
+
+inline bool isCapture(Move move)
+{
+        return moveFlags(move) & MOVE_CAPTURE;
+}
+
+inline bool isPromotion(Move move)
+{
+        return moveFlags(move) & MOVE_PROMOTION;
+}
+
+inline uint8_t promotionType(Move move)
+{
+        return KNIGHT + (moveFlags(move) & 3);
+}
+
+struct MoveList
+{
+        std::array<Move, 256> moves;
+        int count = 0;
+
+        inline void add(Move move) { moves[count++] = move; }
+        inline Move* begin() { return moves.data(); }
+        inline Move* end() { return moves.data() + count; }
+        inline const Move* begin() const { return moves.data(); }
+        inline const Move* end() const { return moves.data() + count; }
+};
+
+const int MAX_PLY = 1024;
+
+// Everything makeMove overwrites that cannot be recomputed from the move itself
+struct UndoInfo
+{
+        uint8_t captured;       // PieceType, NONE if nothing was captured
+        uint8_t castlingRights; // bit 0 K, bit 1 Q, bit 2 k, bit 3 q
+        int8_t enPassantSquare;
+        uint16_t halfMoveClock;
+        uint64_t hash;
+};
+
+struct UndoStack
+{
+        std::array<UndoInfo, MAX_PLY> entries;
+        int size = 0;
+};
+
+#endif // CHESS_MOVE_H
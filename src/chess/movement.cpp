@@ -1,6 +1,8 @@
 #include <iostream>
 
-#include "gamestate.h"
+#include "movement.h"
+#include "zobrist.h"
+#include "../profiler.h"
 
 /*
 rnbqkbnr
@@ -24,407 +26,423 @@ RNBQKBNR
 
 */
 
-void generatePawnMoves(BoardState& boardState, int i)
-{
-        int direction = boardState.pieces[i].isWhite ? -1 : 1;
-        int startRank = boardState.pieces[i].isWhite ? 6 : 1;
-        int rank = i / 8;
-        int file = i % 8;
-        int forwardSquare = i + direction * 8;
-        int forwardTwoSquare = i + direction * 16;
-        int leftCaptureSquare = i + direction * 8 - 1;
-        int rightCaptureSquare = i + direction * 8 + 1;
-        bool canMoveForward = (rank + direction >= 0 && rank + direction < 8) && boardState.pieces[forwardSquare].type == NONE;
-        bool canMoveForwardTwo = (rank + direction * 2 >= 0 && rank + direction * 2 < 8) && boardState.pieces[forwardTwoSquare].type == NONE;
-        bool canCaptureLeft = (rank + direction >= 0 && rank + direction < 8) && (file - 1 >= 0) && boardState.pieces[leftCaptureSquare].type != NONE && boardState.pieces[leftCaptureSquare].isWhite != boardState.pieces[i].isWhite;
-        bool canCaptureRight = (rank + direction >= 0 && rank + direction < 8) && (file + 1 < 8) && boardState.pieces[rightCaptureSquare].type != NONE && boardState.pieces[rightCaptureSquare].isWhite != boardState.pieces[i].isWhite;
-
-        if (canMoveForward)
-        {
-                boardState.canMoveTo[i][forwardSquare] = true;
-                if (canMoveForwardTwo && rank == startRank)
-                {
-                        boardState.canMoveTo[i][forwardTwoSquare] = true;
-                }
+Bitboard attackersTo(const BoardState& boardState, int square, Bitboard occupied)
+{
+        const std::array<Bitboard, 7>& pieceBB = boardState.pieceBB;
+        Bitboard bishopsQueens = pieceBB[BISHOP] | pieceBB[QUEEN];
+        Bitboard rooksQueens = pieceBB[ROOK] | pieceBB[QUEEN];
+
+        return (pawnAttacks(BLACK, square) & pieceBB[PAWN] & boardState.colorBB[WHITE]) |
+               (pawnAttacks(WHITE, square) & pieceBB[PAWN] & boardState.colorBB[BLACK]) |
+               (knightAttacks(square) & pieceBB[KNIGHT]) |
+               (kingAttacks(square) & pieceBB[KING]) |
+               (bishopAttacks(square, occupied) & bishopsQueens) |
+               (rookAttacks(square, occupied) & rooksQueens);
+}
+
+bool isSquareAttacked(const BoardState& boardState, int square, bool byWhite)
+{
+        return attackersTo(boardState, square, boardState.occupied) & boardState.colorBB[byWhite ? WHITE : BLACK];
+}
+
+void addMoves(MoveList& moves, int from, Bitboard targets, Bitboard enemies)
+{
+        while (targets)
+        {
+                int to = popLSB(targets);
+                moves.add(encodeMove(from, to, (enemies & squareBB(to)) ? MOVE_CAPTURE : MOVE_QUIET));
         }
+}
+
+// Queen first so that findMove picks it for the GUI's auto-queen
+void addPromotions(MoveList& moves, int from, int to, bool isCapture)
+{
+        int flags = isCapture ? MOVE_PROMOTION_CAPTURE : MOVE_PROMOTION;
+        for (int promotion = 3; promotion >= 0; promotion--)
+                moves.add(encodeMove(from, to, flags | promotion));
+}
 
-        if (canCaptureLeft)
+// Pawn moves are generated set-wise, the origin square is recovered from the shift offset
+void addPawnMoves(MoveList& moves, Bitboard targets, int offset, int flags)
+{
+        while (targets)
         {
-                boardState.canMoveTo[i][leftCaptureSquare] = true;
+                int to = popLSB(targets);
+                moves.add(encodeMove(to + offset, to, flags));
         }
+}
 
-        if (canCaptureRight)
+void addPawnPromotions(MoveList& moves, Bitboard targets, int offset, bool isCapture)
+{
+        while (targets)
         {
-                boardState.canMoveTo[i][rightCaptureSquare] = true;
+                int to = popLSB(targets);
+                addPromotions(moves, to + offset, to, isCapture);
         }
+}
 
-        // En passant
+void generatePawnMoves(const BoardState& boardState, MoveList& moves, GenType type, Bitboard targets)
+{
+        bool isWhite = boardState.isWhiteTurn;
+        Bitboard pawns = boardState.pieceBB[PAWN] & boardState.colorBB[isWhite ? WHITE : BLACK];
+        Bitboard empty = ~boardState.occupied;
+        Bitboard enemies = boardState.colorBB[isWhite ? BLACK : WHITE];
+        Bitboard promotionRank = isWhite ? RANK_8 : RANK_1;
 
-        int enPassantRank = boardState.enPassantSquare / 8;
-        const int whiteEnPassantRank = 2;
-        const int blackEnPassantRank = 7;
+        Bitboard forward = (isWhite ? shiftNorth(pawns) : shiftSouth(pawns)) & empty;
+        Bitboard forwardTwo = (isWhite ? shiftNorth(forward & RANK_3) : shiftSouth(forward & RANK_6)) & empty;
+        Bitboard westCaptures = (isWhite ? shiftNorth(shiftWest(pawns)) : shiftSouth(shiftWest(pawns))) & enemies & targets;
+        Bitboard eastCaptures = (isWhite ? shiftNorth(shiftEast(pawns)) : shiftSouth(shiftEast(pawns))) & enemies & targets;
+        forward &= targets;
+        forwardTwo &= targets;
 
-        bool enPassantCorrectColor = boardState.pieces[i].isWhite && enPassantRank == whiteEnPassantRank ||
-                                     !boardState.pieces[i].isWhite && enPassantRank == blackEnPassantRank;
+        int pushOffset = isWhite ? 8 : -8;
+        int westOffset = isWhite ? 9 : -7;
+        int eastOffset = isWhite ? 7 : -9;
 
-        if (boardState.enPassantSquare != -1 && enPassantCorrectColor)
+        if (type != GEN_CAPTURES)
         {
-                int enPassantFile = boardState.enPassantSquare % 8;
-                bool enPassantSquareFree = boardState.pieces[boardState.enPassantSquare].type == NONE;
-                if (enPassantRank == rank + direction && (enPassantFile == file - 1 || enPassantFile == file + 1) && enPassantSquareFree)
-                {
-                        boardState.canMoveTo[i][boardState.enPassantSquare] = true;
-                }
+                addPawnMoves(moves, forward & ~promotionRank, pushOffset, MOVE_QUIET);
+                addPawnMoves(moves, forwardTwo, pushOffset * 2, MOVE_DOUBLE_PUSH);
         }
-}
 
-void generateKnightMoves(BoardState& boardState, int i)
-{
-        const int knightMoves[8][2] = {
-                {2, 1}, {2, -1}, {-2, 1}, {-2, -1},
-                {1, 2}, {1, -2}, {-1, 2}, {-1, -2}
-        };
+        if (type == GEN_QUIETS)
+                return;
 
-        int rank = i / 8;
-        int file = i % 8;
+        addPawnPromotions(moves, forward & promotionRank, pushOffset, false);
+        addPawnPromotions(moves, westCaptures & promotionRank, westOffset, true);
+        addPawnPromotions(moves, eastCaptures & promotionRank, eastOffset, true);
+        addPawnMoves(moves, westCaptures & ~promotionRank, westOffset, MOVE_CAPTURE);
+        addPawnMoves(moves, eastCaptures & ~promotionRank, eastOffset, MOVE_CAPTURE);
 
-        for (int j = 0; j < 8; j++)
+        if (boardState.enPassantSquare != -1)
         {
-                int newRank = rank + knightMoves[j][0];
-                int newFile = file + knightMoves[j][1];
-                if (newRank >= 0 && newRank < 8 && newFile >= 0 && newFile < 8)
+                // An evasion may capture the checking pawn even though the target square is not a block
+                int capturedSquare = boardState.enPassantSquare + pushOffset;
+                if (targets & (squareBB(boardState.enPassantSquare) | squareBB(capturedSquare)))
                 {
-                        int newIndex = newRank * 8 + newFile;
-                        if (boardState.pieces[newIndex].type == NONE || boardState.pieces[newIndex].isWhite != boardState.pieces[i].isWhite)
-                        {
-                                boardState.canMoveTo[i][newIndex] = true;
-                        }
+                        Bitboard attackers = pawnAttacks(isWhite ? BLACK : WHITE, boardState.enPassantSquare) & pawns;
+                        while (attackers)
+                                moves.add(encodeMove(popLSB(attackers), boardState.enPassantSquare, MOVE_EN_PASSANT));
                 }
         }
 }
 
-void generateBishopMoves(BoardState& boardState, int i)
+void generatePieceMoves(const BoardState& boardState, MoveList& moves, Bitboard targets)
 {
-        int rank = i / 8;
-        int file = i % 8;
+        Bitboard own = boardState.colorBB[boardState.isWhiteTurn ? WHITE : BLACK];
+        Bitboard enemies = boardState.colorBB[boardState.isWhiteTurn ? BLACK : WHITE];
+        Bitboard occupied = boardState.occupied;
+        Bitboard pieces;
 
-        for (int r = -1; r <= 1; r += 2)
+        pieces = boardState.pieceBB[KNIGHT] & own;
+        while (pieces)
         {
-                for (int f = -1; f <= 1; f += 2)
-                {
-                        for (int j = 1; j < 8; j++)
-                        {
-                                int newRank = rank + r * j;
-                                int newFile = file + f * j;
-                                if (newRank >= 0 && newRank < 8 && newFile >= 0 && newFile < 8)
-                                {
-                                        int newIndex = newRank * 8 + newFile;
-                                        if (boardState.pieces[newIndex].type == NONE)
-                                        {
-                                                boardState.canMoveTo[i][newIndex] = true;
-                                        }
-                                        else if (boardState.pieces[newIndex].isWhite != boardState.pieces[i].isWhite)
-                                        {
-                                                boardState.canMoveTo[i][newIndex] = true;
-                                                break;
-                                        }
-                                        else
-                                        {
-                                                break;
-                                        }
-                                }
-                        }
-                }
+                int from = popLSB(pieces);
+                addMoves(moves, from, knightAttacks(from) & targets, enemies);
         }
-}
 
-void generateRookMoves(BoardState& boardState, int i)
-{
-        int rank = i / 8;
-        int file = i % 8;
+        pieces = boardState.pieceBB[BISHOP] & own;
+        while (pieces)
+        {
+                int from = popLSB(pieces);
+                addMoves(moves, from, bishopAttacks(from, occupied) & targets, enemies);
+        }
 
-        for (int r = -1; r <= 1; r += 2)
+        pieces = boardState.pieceBB[ROOK] & own;
+        while (pieces)
         {
-                for (int j = 1; j < 8; j++)
-                {
-                        int newRank = rank + r * j;
-                        if (newRank >= 0 && newRank < 8)
-                        {
-                                int newIndex = newRank * 8 + file;
-                                if (boardState.pieces[newIndex].type == NONE)
-                                {
-                                        boardState.canMoveTo[i][newIndex] = true;
-                                }
-                                else if (boardState.pieces[newIndex].isWhite != boardState.pieces[i].isWhite)
-                                {
-                                        boardState.canMoveTo[i][newIndex] = true;
-                                        break;
-                                }
-                                else
-                                {
-                                        break;
-                                }
-                        }
-                }
+                int from = popLSB(pieces);
+                addMoves(moves, from, rookAttacks(from, occupied) & targets, enemies);
         }
 
-        for (int f = -1; f <= 1; f += 2)
+        pieces = boardState.pieceBB[QUEEN] & own;
+        while (pieces)
         {
-                for (int j = 1; j < 8; j++)
-                {
-                        int newFile = file + f * j;
-                        if (newFile >= 0 && newFile < 8)
-                        {
-                                int newIndex = rank * 8 + newFile;
-                                if (boardState.pieces[newIndex].type == NONE)
-                                {
-                                        boardState.canMoveTo[i][newIndex] = true;
-                                }
-                                else if (boardState.pieces[newIndex].isWhite != boardState.pieces[i].isWhite)
-                                {
-                                        boardState.canMoveTo[i][newIndex] = true;
-                                        break;
-                                }
-                                else
-                                {
-                                        break;
-                                }
-                        }
-                }
+                int from = popLSB(pieces);
+                addMoves(moves, from, queenAttacks(from, occupied) & targets, enemies);
         }
 }
 
-void generateKingMoves(BoardState& boardState, int i)
+bool canCastle(const BoardState& boardState, int kingSquare, int rookSquare, Bitboard between, const int* kingPath)
 {
-        const int kingMoves[8][2] = {
-                {1, 0}, {1, 1}, {0, 1}, {-1, 1},
-                {-1, 0}, {-1, -1}, {0, -1}, {1, -1}
-        };
-
-        int rank = i / 8;
-        int file = i % 8;
+        int side = boardState.isWhiteTurn ? WHITE : BLACK;
+        Bitboard own = boardState.colorBB[side];
+        if (!(boardState.pieceBB[KING] & own & squareBB(kingSquare)) ||
+            !(boardState.pieceBB[ROOK] & own & squareBB(rookSquare)) ||
+            (boardState.occupied & between))
+        {
+                return false;
+        }
 
-        for (int j = 0; j < 8; j++)
+        for (int i = 0; i < 3; i++)
         {
-                int newRank = rank + kingMoves[j][0];
-                int newFile = file + kingMoves[j][1];
-                if (newRank >= 0 && newRank < 8 && newFile >= 0 && newFile < 8)
-                {
-                        int newIndex = newRank * 8 + newFile;
-                        if (boardState.pieces[newIndex].type == NONE || boardState.pieces[newIndex].isWhite != boardState.pieces[i].isWhite)
-                        {
-                                boardState.canMoveTo[i][newIndex] = true;
-                        }
-                }
+                if (isSquareAttacked(boardState, kingPath[i], !boardState.isWhiteTurn))
+                        return false;
         }
+        return true;
 }
 
-void generateCastlingMoves(BoardState& boardState)
+void generateCastlingMoves(const BoardState& boardState, MoveList& moves)
 {
+        const int whiteKingside[3] = {60, 61, 62};
+        const int whiteQueenside[3] = {60, 59, 58};
+        const int blackKingside[3] = {4, 5, 6};
+        const int blackQueenside[3] = {4, 3, 2};
+
         if (boardState.isWhiteTurn)
         {
-                if (boardState.whiteCanCastleKingside)
+                if (boardState.whiteCanCastleKingside &&
+                    canCastle(boardState, 60, 63, squareBB(61) | squareBB(62), whiteKingside))
                 {
-                        if (boardState.pieces[60].type == KING && boardState.pieces[63].type == ROOK &&
-                                boardState.pieces[61].type == NONE && boardState.pieces[62].type == NONE)
-                        {
-                                boardState.canMoveTo[60][62] = true;
-                        }
+                        moves.add(encodeMove(60, 62, MOVE_KING_CASTLE));
                 }
-                if (boardState.whiteCanCastleQueenside)
+                if (boardState.whiteCanCastleQueenside &&
+                    canCastle(boardState, 60, 56, squareBB(57) | squareBB(58) | squareBB(59), whiteQueenside))
                 {
-                        if (boardState.pieces[60].type == KING && boardState.pieces[56].type == ROOK &&
-                                boardState.pieces[57].type == NONE && boardState.pieces[58].type == NONE)
-                        {
-                                boardState.canMoveTo[60][58] = true;
-                        }
+                        moves.add(encodeMove(60, 58, MOVE_QUEEN_CASTLE));
                 }
         }
         else
         {
-                if (boardState.blackCanCastleKingside)
+                if (boardState.blackCanCastleKingside &&
+                    canCastle(boardState, 4, 7, squareBB(5) | squareBB(6), blackKingside))
                 {
-                        if (boardState.pieces[4].type == KING && boardState.pieces[7].type == ROOK &&
-                                boardState.pieces[5].type == NONE && boardState.pieces[6].type == NONE)
-                        {
-                                boardState.canMoveTo[4][6] = true;
-                        }
+                        moves.add(encodeMove(4, 6, MOVE_KING_CASTLE));
                 }
-                if (boardState.blackCanCastleQueenside)
+                if (boardState.blackCanCastleQueenside &&
+                    canCastle(boardState, 4, 0, squareBB(1) | squareBB(2) | squareBB(3), blackQueenside))
                 {
-                        if (boardState.pieces[4].type == KING && boardState.pieces[0].type == ROOK &&
-                                boardState.pieces[1].type == NONE && boardState.pieces[2].type == NONE)
-                        {
-                                boardState.canMoveTo[4][2] = true;
-                        }
+                        moves.add(encodeMove(4, 2, MOVE_QUEEN_CASTLE));
                 }
         }
+}
 
-        if (boardState.canMoveTo[60][62])
-        {
-                const int squaresToCheck[3] = {60, 61, 62};
-                for (int i = 0; i < 3; i++)
-                {
-                        int square = squaresToCheck[i];
-                        for (int j = 0; j < 64; j++)
-                        {
-                                if (boardState.canMoveTo[j][square] && boardState.pieces[j].isWhite != boardState.isWhiteTurn)
-                                {
-                                        boardState.canMoveTo[60][62] = false;
-                                        break;
-                                }
-                        }
-                }
-        }
+void generateMoves(const BoardState& boardState, MoveList& moves, GenType type)
+{
+        Bitboard own = boardState.colorBB[boardState.isWhiteTurn ? WHITE : BLACK];
+        Bitboard enemies = boardState.colorBB[boardState.isWhiteTurn ? BLACK : WHITE];
+        Bitboard ownKing = boardState.pieceBB[KING] & own;
+        if (!ownKing)
+                return;
+        int kingIndex = lsb(ownKing);
 
-        if (boardState.canMoveTo[60][58])
+        Bitboard checkers = 0;
+        if (type == GEN_EVASIONS)
         {
-                const int squaresToCheck[4] = {60, 57, 58, 59};
-                for (int i = 0; i < 4; i++)
-                {
-                        int square = squaresToCheck[i];
-                        for (int j = 0; j < 64; j++)
-                        {
-                                if (boardState.canMoveTo[j][square] && boardState.pieces[j].isWhite != boardState.isWhiteTurn)
-                                {
-                                        boardState.canMoveTo[60][58] = false;
-                                        break;
-                                }
-                        }
-                }
+                checkers = attackersTo(boardState, kingIndex, boardState.occupied) & enemies;
+                if (!checkers)
+                        type = GEN_ALL;
         }
 
-        if (boardState.canMoveTo[4][6])
+        Bitboard targets;
+        Bitboard kingTargets;
+        switch (type)
         {
-                const int squaresToCheck[3] = {4, 5, 6};
-                for (int i = 0; i < 3; i++)
-                {
-                        int square = squaresToCheck[i];
-                        for (int j = 0; j < 64; j++)
-                        {
-                                if (boardState.canMoveTo[j][square] && boardState.pieces[j].isWhite != boardState.isWhiteTurn)
-                                {
-                                        boardState.canMoveTo[4][6] = false;
-                                        break;
-                                }
-                        }
-                }
+                case GEN_CAPTURES:
+                        targets = enemies;
+                        kingTargets = enemies;
+                        break;
+                case GEN_QUIETS:
+                        targets = ~boardState.occupied;
+                        kingTargets = ~boardState.occupied;
+                        break;
+                case GEN_EVASIONS:
+                        targets = checkers | betweenBB(kingIndex, lsb(checkers));
+                        kingTargets = ~own;
+                        break;
+                default:
+                        targets = ~own;
+                        kingTargets = ~own;
+                        break;
         }
 
-        if (boardState.canMoveTo[4][2])
+        // In double check only the king can move
+        if (type != GEN_EVASIONS || popCount(checkers) == 1)
         {
-                const int squaresToCheck[4] = {4, 3, 2, 1};
-                for (int i = 0; i < 4; i++)
-                {
-                        int square = squaresToCheck[i];
-                        for (int j = 0; j < 64; j++)
-                        {
-                                if (boardState.canMoveTo[j][square] && boardState.pieces[j].isWhite != boardState.isWhiteTurn)
-                                {
-                                        boardState.canMoveTo[4][2] = false;
-                                        break;
-                                }
-                        }
-                }
+                // Promotion pushes land on empty squares even when only captures are wanted
+                generatePawnMoves(boardState, moves, type, type == GEN_CAPTURES ? ~own : targets);
+                generatePieceMoves(boardState, moves, targets);
         }
+
+        addMoves(moves, kingIndex, kingAttacks(kingIndex) & kingTargets, enemies);
+
+        if (type == GEN_QUIETS || type == GEN_ALL)
+                generateCastlingMoves(boardState, moves);
+}
+
+void generatePossibleMoves(const BoardState& boardState, MoveList& moves)
+{
+        generateMoves(boardState, moves, GEN_ALL);
+}
+
+void generateCaptures(const BoardState& boardState, MoveList& moves)
+{
+        generateMoves(boardState, moves, GEN_CAPTURES);
+}
+
+void generateQuiets(const BoardState& boardState, MoveList& moves)
+{
+        generateMoves(boardState, moves, GEN_QUIETS);
 }
 
-void generatePossibleMoves(BoardState& boardState)
+void generateEvasions(const BoardState& boardState, MoveList& moves)
 {
-        boardState.canMoveTo.fill({false});
-        for (int i = 0; i < 64; i++)
+        generateMoves(boardState, moves, GEN_EVASIONS);
+}
+
+// Own pieces that are the only blocker between the king and an enemy slider
+Bitboard pinnedPieces(const BoardState& boardState, bool isWhite)
+{
+        Bitboard own = boardState.colorBB[isWhite ? WHITE : BLACK];
+        Bitboard enemies = boardState.colorBB[isWhite ? BLACK : WHITE];
+        int kingIndex = lsb(boardState.pieceBB[KING] & own);
+
+        Bitboard snipers = ((rookAttacks(kingIndex, enemies) & (boardState.pieceBB[ROOK] | boardState.pieceBB[QUEEN])) |
+                            (bishopAttacks(kingIndex, enemies) & (boardState.pieceBB[BISHOP] | boardState.pieceBB[QUEEN]))) &
+                           enemies;
+
+        Bitboard pinned = 0;
+        while (snipers)
         {
-                const Piece piece = boardState.pieces[i];
-                switch (piece.type)
-                {
-                        case NONE:
-                                break;
-                        case PAWN:
-                                generatePawnMoves(boardState, i);
-                                break;
-                        case KNIGHT:
-                                generateKnightMoves(boardState, i);
-                                break;
-                        case BISHOP:
-                                generateBishopMoves(boardState, i);
-                                break;
-                        case ROOK:
-                                generateRookMoves(boardState, i);
-                                break;
-                        case QUEEN:
-                                generateBishopMoves(boardState, i);
-                                generateRookMoves(boardState, i);
-                                break;
-                        case KING:
-                                generateKingMoves(boardState, i);
-                                break;
-                        default:
-                                std::cerr << "Invalid piece type\n";
-                                return;
-                }
+                Bitboard blockers = betweenBB(kingIndex, popLSB(snipers)) & boardState.occupied;
+                if (popCount(blockers) == 1)
+                        pinned |= blockers & own;
         }
+        return pinned;
+}
+
+// Checks a pseudo-legal move of the side to move against the king square and pin mask
+bool isLegal(const BoardState& boardState, Move move, Bitboard pinned)
+{
+        bool isWhite = boardState.isWhiteTurn;
+        int fromIndex = moveFrom(move);
+        int toIndex = moveTo(move);
+        Bitboard kingBB = boardState.pieceBB[KING] & boardState.colorBB[isWhite ? WHITE : BLACK];
+        Bitboard enemies = boardState.colorBB[isWhite ? BLACK : WHITE];
+        int kingIndex = lsb(kingBB);
 
-        if(!boardState.whiteCanCastleKingside && !boardState.whiteCanCastleQueenside &&
-           !boardState.blackCanCastleKingside && !boardState.blackCanCastleQueenside)
+        // The king is taken off the board so that it cannot hide behind itself on a slider ray.
+        // Castling paths were already checked by the generator.
+        if (fromIndex == kingIndex)
         {
-                return;
+                if (moveFlags(move) == MOVE_KING_CASTLE || moveFlags(move) == MOVE_QUEEN_CASTLE)
+                        return true;
+                return !(attackersTo(boardState, toIndex, boardState.occupied ^ kingBB) & enemies);
         }
-        else
+
+        // En passant removes two pieces from a line, so replay it against the enemy sliders
+        if (moveFlags(move) == MOVE_EN_PASSANT)
         {
-                generateCastlingMoves(boardState);
+                int capturedIndex = toIndex + (isWhite ? 8 : -8);
+                Bitboard occupied = (boardState.occupied ^ squareBB(fromIndex) ^ squareBB(capturedIndex)) | squareBB(toIndex);
+                Bitboard rooksQueens = (boardState.pieceBB[ROOK] | boardState.pieceBB[QUEEN]) & enemies;
+                Bitboard bishopsQueens = (boardState.pieceBB[BISHOP] | boardState.pieceBB[QUEEN]) & enemies;
+                return !(rookAttacks(kingIndex, occupied) & rooksQueens) && !(bishopAttacks(kingIndex, occupied) & bishopsQueens);
         }
+
+        return !(pinned & squareBB(fromIndex)) || (lineBB(kingIndex, fromIndex) & squareBB(toIndex));
 }
 
-void eliminateCheckMoves(BoardState& boardState, int i)
+bool isPseudoLegal(const BoardState& boardState, Move move)
 {
-        int kingIndex = -1;
-        for (int j = 0; j < 64; j++)
+        bool isWhite = boardState.isWhiteTurn;
+        Bitboard own = boardState.colorBB[isWhite ? WHITE : BLACK];
+        Bitboard enemies = boardState.colorBB[isWhite ? BLACK : WHITE];
+        int fromIndex = moveFrom(move);
+        int toIndex = moveTo(move);
+        if (move == MOVE_NONE || !(own & squareBB(fromIndex)) || (own & squareBB(toIndex)))
+                return false;
+
+        // Castling, double pushes, en passant and promotions are rare enough to look up in the full list
+        int flags = moveFlags(move);
+        if (flags != MOVE_QUIET && flags != MOVE_CAPTURE)
         {
-                if (boardState.pieces[j].type == KING &&
-                        boardState.pieces[j].isWhite == boardState.isWhiteTurn)
+                MoveList moves;
+                generateMoves(boardState, moves, GEN_ALL);
+                for (Move candidate : moves)
                 {
-                        kingIndex = j;
-                        break;
+                        if (candidate == move)
+                                return true;
                 }
+                return false;
+        }
+
+        bool targetOccupied = enemies & squareBB(toIndex);
+        if ((flags == MOVE_CAPTURE) != targetOccupied)
+                return false;
+
+        switch (getPiece(boardState, fromIndex).type)
+        {
+                case PAWN:
+                        if (squareBB(toIndex) & (RANK_8 | RANK_1))
+                                return false;
+                        if (flags == MOVE_CAPTURE)
+                                return pawnAttacks(isWhite ? WHITE : BLACK, fromIndex) & squareBB(toIndex);
+                        return toIndex == fromIndex + (isWhite ? -8 : 8);
+                case KNIGHT:
+                        return knightAttacks(fromIndex) & squareBB(toIndex);
+                case BISHOP:
+                        return bishopAttacks(fromIndex, boardState.occupied) & squareBB(toIndex);
+                case ROOK:
+                        return rookAttacks(fromIndex, boardState.occupied) & squareBB(toIndex);
+                case QUEEN:
+                        return queenAttacks(fromIndex, boardState.occupied) & squareBB(toIndex);
+                case KING:
+                        return kingAttacks(fromIndex) & squareBB(toIndex);
+                default:
+                        return false;
+        }
+}
+
+void generateLegalMoves(const BoardState& boardState, MoveList& moves)
+{
+        Bitboard own = boardState.colorBB[boardState.isWhiteTurn ? WHITE : BLACK];
+        Bitboard enemies = boardState.colorBB[boardState.isWhiteTurn ? BLACK : WHITE];
+        Bitboard ownKing = boardState.pieceBB[KING] & own;
+        if (!ownKing)
+                return;
+
+        // Evasions already restrict non-king moves to the check mask
+        bool inCheck = attackersTo(boardState, lsb(ownKing), boardState.occupied) & enemies;
+        int first = moves.count;
+        generateMoves(boardState, moves, inCheck ? GEN_EVASIONS : GEN_ALL);
+
+        Bitboard pinned = pinnedPieces(boardState, boardState.isWhiteTurn);
+        int legalCount = first;
+        for (int i = first; i < moves.count; i++)
+        {
+                if (isLegal(boardState, moves.moves[i], pinned))
+                        moves.moves[legalCount++] = moves.moves[i];
         }
+        moves.count = legalCount;
+}
 
-        for (int j = 0; j < 64; j++)
+Move findMove(const MoveList& moves, int fromIndex, int toIndex)
+{
+        for (Move move : moves)
         {
-                if (boardState.canMoveTo[i][j])
-                {
-                        BoardState tempBoardState = boardState;
-                        tempBoardState.pieces[j] = tempBoardState.pieces[i];
-                        tempBoardState.pieces[i] = {NONE, false};
-
-                        int newKingIndex = kingIndex;
-                        if (boardState.pieces[i].type == KING)
-                        {
-                                newKingIndex = j;
-                        }
-
-                        generatePossibleMoves(tempBoardState);
-
-                        bool kingInCheck = false;
-                        for (int k = 0; k < 64; k++)
-                        {
-                                if (tempBoardState.canMoveTo[k][newKingIndex] &&
-                                        tempBoardState.pieces[k].isWhite != boardState.isWhiteTurn &&
-                                        tempBoardState.pieces[k].type != KING)
-                                {
-                                        kingInCheck = true;
-                                        break;
-                                }
-                        }
-
-                        if (kingInCheck)
-                        {
-                                boardState.canMoveTo[i][j] = false;
-                        }
-                }
+                if (moveFrom(move) == fromIndex && moveTo(move) == toIndex)
+                        return move;
         }
+        return MOVE_NONE;
+}
+
+// Long algebraic notation as used by UCI, e.g. e2e4 or e7e8q
+std::string moveToString(Move move)
+{
+        const char promotionChars[4] = {'n', 'b', 'r', 'q'};
+        std::string text;
+        text += (char)('a' + moveFrom(move) % 8);
+        text += (char)('8' - moveFrom(move) / 8);
+        text += (char)('a' + moveTo(move) % 8);
+        text += (char)('8' - moveTo(move) / 8);
+        if (isPromotion(move))
+                text += promotionChars[moveFlags(move) & 3];
+        return text;
 }
 
-bool checkLegality(const BoardState& boardState, int fromIndex, int toIndex)
+bool checkLegality(const BoardState& boardState, const MoveList& moves, int fromIndex, int toIndex)
 {
         if (fromIndex < 0 || fromIndex > 63 || toIndex < 0 || toIndex > 63)
         {
@@ -438,31 +456,34 @@ bool checkLegality(const BoardState& boardState, int fromIndex, int toIndex)
                 return false;
         }
 
-        if (boardState.pieces[fromIndex].type == NONE)
+        Piece fromPiece = getPiece(boardState, fromIndex);
+        Piece toPiece = getPiece(boardState, toIndex);
+
+        if (fromPiece.type == NONE)
         {
                 std::cerr << "No piece at from index\n";
                 return false;
         }
 
-        if (boardState.pieces[fromIndex].isWhite != boardState.isWhiteTurn)
+        if (fromPiece.isWhite != boardState.isWhiteTurn)
         {
                 std::cerr << "From index is occupied by opposite color\n";
                 return false;
         }
 
-        if (boardState.pieces[toIndex].isWhite == boardState.isWhiteTurn && boardState.pieces[toIndex].type != NONE)
+        if (toPiece.isWhite == boardState.isWhiteTurn && toPiece.type != NONE)
         {
                 std::cerr << "To index is occupied by same color\n";
                 return false;
         }
 
-        if (!boardState.canMoveTo[fromIndex][toIndex])
+        if (findMove(moves, fromIndex, toIndex) == MOVE_NONE)
         {
                 std::cerr << "Move is not legal\n";
                 return false;
         }
 
-        if (boardState.pieces[toIndex].type == KING)
+        if (toPiece.type == KING)
         {
                 std::cerr << "Move target is king\n";
                 return false;
@@ -472,138 +493,243 @@ bool checkLegality(const BoardState& boardState, int fromIndex, int toIndex)
         return true;
 }
 
-void pawnMoved(BoardState& boardState, int fromIndex, int toIndex)
+uint8_t packCastlingRights(const BoardState& boardState)
+{
+        return (boardState.whiteCanCastleKingside ? 1 : 0) | (boardState.whiteCanCastleQueenside ? 2 : 0) |
+               (boardState.blackCanCastleKingside ? 4 : 0) | (boardState.blackCanCastleQueenside ? 8 : 0);
+}
+
+void unpackCastlingRights(BoardState& boardState, uint8_t rights)
+{
+        boardState.whiteCanCastleKingside = rights & 1;
+        boardState.whiteCanCastleQueenside = rights & 2;
+        boardState.blackCanCastleKingside = rights & 4;
+        boardState.blackCanCastleQueenside = rights & 8;
+}
+
+// The hashed variants keep BoardState::hash in step, unmakeMove restores it from the undo record instead
+inline void putPieceHashed(BoardState& boardState, int square, Piece piece)
+{
+        putPiece(boardState, square, piece);
+        boardState.hash ^= zobrist.pieces[piece.isWhite ? WHITE : BLACK][piece.type][square];
+}
+
+inline void removePieceHashed(BoardState& boardState, int square, Piece piece)
+{
+        removePiece(boardState, square, piece);
+        boardState.hash ^= zobrist.pieces[piece.isWhite ? WHITE : BLACK][piece.type][square];
+}
+
+inline void setEnPassantSquare(BoardState& boardState, int square)
+{
+        if (boardState.enPassantSquare != -1)
+                boardState.hash ^= zobrist.enPassantFile[boardState.enPassantSquare % 8];
+        boardState.enPassantSquare = square;
+        if (square != -1)
+                boardState.hash ^= zobrist.enPassantFile[square % 8];
+}
+
+// right is the index into zobrist.castling: K, Q, k, q
+inline void revokeCastlingRight(BoardState& boardState, bool& canCastle, int right)
 {
-        Piece movedPiece = boardState.pieces[fromIndex];
+        if (canCastle)
+        {
+                canCastle = false;
+                boardState.hash ^= zobrist.castling[right];
+        }
+}
+
+void pawnMoved(BoardState& boardState, Move move)
+{
+        int fromIndex = moveFrom(move);
+        int toIndex = moveTo(move);
+        Piece movedPiece = getPiece(boardState, fromIndex);
         if (movedPiece.type == PAWN)
         {
-                int fromFile = fromIndex % 8;
-                int toFile = toIndex % 8;
-                int fileDistance = toFile - fromFile;
-                if (boardState.enPassantSquare == toIndex && (fileDistance == 1 || fileDistance == -1))
+                if (moveFlags(move) == MOVE_EN_PASSANT)
                 {
                         int capturedPawnIndex = toIndex + (movedPiece.isWhite ? 8 : -8);
-                        boardState.pieces[capturedPawnIndex] = {NONE, false};
-                        boardState.enPassantSquare = -1;
+                        removePieceHashed(boardState, capturedPawnIndex, {PAWN, !movedPiece.isWhite});
                 }
 
-                int fromRank = fromIndex / 8;
-                int toRank = toIndex / 8;
-                int rankDistance = toRank - fromRank;
-                if (rankDistance == 2 || rankDistance == -2)
+                if (moveFlags(move) == MOVE_DOUBLE_PUSH)
                 {
-                        boardState.enPassantSquare = fromIndex + (movedPiece.isWhite ? 8 : -8);
+                        setEnPassantSquare(boardState, fromIndex + (movedPiece.isWhite ? -8 : 8));
                 }
                 else
                 {
-                        boardState.enPassantSquare = -1;
+                        setEnPassantSquare(boardState, -1);
                 }
 
-                if (toRank == 0 && movedPiece.isWhite)
-                {
-                        // TODO: prompt user for promotion
-                        boardState.pieces[toIndex] = {QUEEN, true};
-                }
-                else if (toRank == 7 && !movedPiece.isWhite)
+                // The pawn is promoted in place, makeMove then carries the new piece to toIndex.
+                // The GUI always picks the queen (TODO: prompt user for promotion)
+                if (isPromotion(move))
                 {
-                        // TODO: prompt user for promotion
-                        boardState.pieces[toIndex] = {QUEEN, false};
+                        removePieceHashed(boardState, fromIndex, movedPiece);
+                        putPieceHashed(boardState, fromIndex, {promotionType(move), movedPiece.isWhite});
                 }
         }
         else
         {
-                boardState.enPassantSquare = -1;
+                setEnPassantSquare(boardState, -1);
         }
 }
 
-void rookMoved(BoardState& boardState, int fromIndex, int toIndex)
+void rookMoved(BoardState& boardState, Move move)
 {
-        Piece movedPiece = boardState.pieces[fromIndex];
-        if (movedPiece.type == ROOK)
+        // A rook leaving or being captured on its home square loses that castling right
+        Bitboard touched = squareBB(moveFrom(move)) | squareBB(moveTo(move));
+        Bitboard rooks = boardState.pieceBB[ROOK];
+        if (touched & rooks & boardState.colorBB[BLACK] & squareBB(0))
         {
-                if (fromIndex == 0 && !movedPiece.isWhite)
-                {
-                        boardState.blackCanCastleQueenside = false;
-                }
-                else if (fromIndex == 7 && !movedPiece.isWhite)
-                {
-                        boardState.blackCanCastleKingside = false;
-                }
-                else if (fromIndex == 56 && movedPiece.isWhite)
-                {
-                        boardState.whiteCanCastleQueenside = false;
-                }
-                else if (fromIndex == 63 && movedPiece.isWhite)
-                {
-                        boardState.whiteCanCastleKingside = false;
-                }
+                revokeCastlingRight(boardState, boardState.blackCanCastleQueenside, 3);
         }
+        if (touched & rooks & boardState.colorBB[BLACK] & squareBB(7))
+        {
+                revokeCastlingRight(boardState, boardState.blackCanCastleKingside, 2);
+        }
+        if (touched & rooks & boardState.colorBB[WHITE] & squareBB(56))
+        {
+                revokeCastlingRight(boardState, boardState.whiteCanCastleQueenside, 1);
+        }
+        if (touched & rooks & boardState.colorBB[WHITE] & squareBB(63))
+        {
+                revokeCastlingRight(boardState, boardState.whiteCanCastleKingside, 0);
+        }
+}
+
+// Rook squares for a castling move, relative to the king's destination
+void castlingRookSquares(Move move, int& rookFrom, int& rookTo)
+{
+        int toIndex = moveTo(move);
+        rookFrom = moveFlags(move) == MOVE_KING_CASTLE ? toIndex + 1 : toIndex - 2;
+        rookTo = moveFlags(move) == MOVE_KING_CASTLE ? toIndex - 1 : toIndex + 1;
 }
 
-void kingMoved(BoardState& boardState, int fromIndex, int toIndex)
+void kingMoved(BoardState& boardState, Move move)
 {
-        Piece movedPiece = boardState.pieces[fromIndex];
+        int fromIndex = moveFrom(move);
+        Piece movedPiece = getPiece(boardState, fromIndex);
         if (movedPiece.type == KING)
         {
-                if (fromIndex == 4 && !movedPiece.isWhite)
+                if (!movedPiece.isWhite)
                 {
-                        boardState.blackCanCastleKingside = false;
-                        boardState.blackCanCastleQueenside = false;
+                        revokeCastlingRight(boardState, boardState.blackCanCastleKingside, 2);
+                        revokeCastlingRight(boardState, boardState.blackCanCastleQueenside, 3);
                 }
-                else if (fromIndex == 60 && movedPiece.isWhite)
+                else
                 {
-                        boardState.whiteCanCastleKingside = false;
-                        boardState.whiteCanCastleQueenside = false;
+                        revokeCastlingRight(boardState, boardState.whiteCanCastleKingside, 0);
+                        revokeCastlingRight(boardState, boardState.whiteCanCastleQueenside, 1);
                 }
 
-                int toFile = toIndex % 8;
-                int fromFile = fromIndex % 8;
-
-                int fileDistance = toFile - fromFile;
-
-                if (fileDistance == 2)
+                if (moveFlags(move) == MOVE_KING_CASTLE || moveFlags(move) == MOVE_QUEEN_CASTLE)
                 {
-                        if (!boardState.isWhiteTurn)
-                        {
-                                boardState.pieces[5] = {ROOK, false};
-                                boardState.pieces[7] = {NONE, false};
-                        }
-                        else
-                        {
-                                boardState.pieces[61] = {ROOK, true};
-                                boardState.pieces[63] = {NONE, false};
-                        }
-                }
-                else if (fileDistance == -2)
-                {
-                        if (!boardState.isWhiteTurn)
-                        {
-                                boardState.pieces[3] = {ROOK, false};
-                                boardState.pieces[0] = {NONE, false};
-                        }
-                        else
-                        {
-                                boardState.pieces[59] = {ROOK, true};
-                                boardState.pieces[56] = {NONE, false};
-                        }
+                        int rookFrom, rookTo;
+                        castlingRookSquares(move, rookFrom, rookTo);
+                        removePieceHashed(boardState, rookFrom, {ROOK, movedPiece.isWhite});
+                        putPieceHashed(boardState, rookTo, {ROOK, movedPiece.isWhite});
                 }
         }
 }
 
-void movePiece(BoardState& boardState, const Board& board, int fromIndex, int toIndex)
+void makeMove(BoardState& boardState, Move move, UndoStack& history)
 {
-        if (!checkLegality(boardState, fromIndex, toIndex))
-                return;
+        int fromIndex = moveFrom(move);
+        int toIndex = moveTo(move);
 
-        pawnMoved(boardState, fromIndex, toIndex);
-        rookMoved(boardState, fromIndex, toIndex);
-        kingMoved(boardState, fromIndex, toIndex);
+        UndoInfo& undo = history.entries[history.size++];
+        undo.captured = NONE;
+        undo.castlingRights = packCastlingRights(boardState);
+        undo.enPassantSquare = boardState.enPassantSquare;
+        undo.halfMoveClock = boardState.halfMoveClock;
+        undo.hash = boardState.hash;
+
+        bool resetsClock = isCapture(move) || (boardState.pieceBB[PAWN] & squareBB(fromIndex));
+
+        rookMoved(boardState, move);
+        if (isCapture(move) && moveFlags(move) != MOVE_EN_PASSANT)
+        {
+                Piece captured = getPiece(boardState, toIndex);
+                undo.captured = captured.type;
+                removePieceHashed(boardState, toIndex, captured);
+        }
+        pawnMoved(boardState, move);
+        kingMoved(boardState, move);
+
+        Piece movedPiece = getPiece(boardState, fromIndex);
+        removePieceHashed(boardState, fromIndex, movedPiece);
+        putPieceHashed(boardState, toIndex, movedPiece);
 
-        boardState.pieces[toIndex] = boardState.pieces[fromIndex];
-        boardState.pieces[fromIndex] = {NONE, false};
         boardState.isWhiteTurn = !boardState.isWhiteTurn;
-        boardState.halfMoveClock++;
+        boardState.hash ^= zobrist.blackToMove;
+        boardState.halfMoveClock = resetsClock ? 0 : boardState.halfMoveClock + 1;
         boardState.fullMoveClock += boardState.isWhiteTurn ? 1 : 0;
+}
+
+void unmakeMove(BoardState& boardState, Move move, UndoStack& history)
+{
+        int fromIndex = moveFrom(move);
+        int toIndex = moveTo(move);
+        const UndoInfo& undo = history.entries[--history.size];
+
+        boardState.isWhiteTurn = !boardState.isWhiteTurn;
+        boardState.fullMoveClock -= boardState.isWhiteTurn ? 0 : 1;
+
+        Piece movedPiece = getPiece(boardState, toIndex);
+        removePiece(boardState, toIndex, movedPiece);
+        if (isPromotion(move))
+                movedPiece.type = PAWN;
+        putPiece(boardState, fromIndex, movedPiece);
+
+        if (moveFlags(move) == MOVE_EN_PASSANT)
+        {
+                putPiece(boardState, toIndex + (movedPiece.isWhite ? 8 : -8), {PAWN, !movedPiece.isWhite});
+        }
+        else if (undo.captured != NONE)
+        {
+                putPiece(boardState, toIndex, {undo.captured, !movedPiece.isWhite});
+        }
+        else if (moveFlags(move) == MOVE_KING_CASTLE || moveFlags(move) == MOVE_QUEEN_CASTLE)
+        {
+                int rookFrom, rookTo;
+                castlingRookSquares(move, rookFrom, rookTo);
+                removePiece(boardState, rookTo, {ROOK, movedPiece.isWhite});
+                putPiece(boardState, rookFrom, {ROOK, movedPiece.isWhite});
+        }
+
+        unpackCastlingRights(boardState, undo.castlingRights);
+        boardState.enPassantSquare = undo.enPassantSquare;
+        boardState.halfMoveClock = undo.halfMoveClock;
+        boardState.hash = undo.hash;
+}
+
+bool updatePositionCache(PositionCache& cache, const BoardState& boardState)
+{
+        if (cache.valid && cache.hash == boardState.hash)
+                return false;
+
+        PROFILE_SCOPE("legal moves");
+        cache.legalMoves.count = 0;
+        generateLegalMoves(boardState, cache.legalMoves);
+        cache.gameState = checkGameState(boardState, cache.legalMoves);
+        cache.hash = boardState.hash;
+        cache.valid = true;
+        return true;
+}
+
+void movePiece(BoardState& boardState, const MoveList& moves, UndoStack& history, int fromIndex, int toIndex)
+{
+        if (!checkLegality(boardState, moves, fromIndex, toIndex))
+                return;
+
+        if (history.size == MAX_PLY)
+        {
+                std::cerr << "Game history is full\n";
+                return;
+        }
+
+        makeMove(boardState, findMove(moves, fromIndex, toIndex), history);
 
         std::cout << "Turn: " << (boardState.isWhiteTurn ? "White" : "Black") << "\n";
         if (boardState.enPassantSquare != -1)
@@ -613,4 +739,3 @@ void movePiece(BoardState& boardState, const Board& board, int fromIndex, int to
 
         //printBoardState(boardState);
 }
-
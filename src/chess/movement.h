@@ -1,11 +1,52 @@
 #ifndef CHESS_MOVEMENT_H
 #define CHESS_MOVEMENT_H
 
+#include <string>
+
 #include "gamestate.h"
+#include "move.h"
+
+// Generation and make/unmake only touch the BoardState, MoveList and UndoStack passed in
+// and the attack tables, which are read-only after initBitboards(). Threads can therefore
+// work on their own copies of a position concurrently.
+
+enum GenType
+{
+        GEN_CAPTURES = 0, // captures and all promotions
+        GEN_QUIETS,       // non-captures without promotions, castling included
+        GEN_EVASIONS,     // replies to check, falls back to GEN_ALL when not in check
+        GEN_ALL
+};
+
+// Legal moves and game status of the last position seen, recomputed only when the hash changes
+struct PositionCache
+{
+        uint64_t hash = 0;
+        bool valid = false;
+        MoveList legalMoves;
+        int gameState = CONTINUE;
+};
 
-void generatePossibleMoves(BoardState& boardState);
-void eliminateCheckMoves(BoardState& boardState, int i);
-bool checkLegality(const BoardState& boardState, int fromIndex, int toIndex);
-void movePiece(BoardState& boardState, const Board& board, int fromIndex, int toIndex);
+Bitboard attackersTo(const BoardState& boardState, int square, Bitboard occupied);
+bool isSquareAttacked(const BoardState& boardState, int square, bool byWhite);
+void generateMoves(const BoardState& boardState, MoveList& moves, GenType type);
+void generatePossibleMoves(const BoardState& boardState, MoveList& moves);
+void generateCaptures(const BoardState& boardState, MoveList& moves);
+void generateQuiets(const BoardState& boardState, MoveList& moves);
+void generateEvasions(const BoardState& boardState, MoveList& moves);
+Bitboard pinnedPieces(const BoardState& boardState, bool isWhite);
+bool isLegal(const BoardState& boardState, Move move, Bitboard pinned);
+// Whether the generator could have produced move outside of check, for moves taken from
+// tables that may belong to another position. Legality still has to be checked with isLegal.
+bool isPseudoLegal(const BoardState& boardState, Move move);
+void generateLegalMoves(const BoardState& boardState, MoveList& moves);
+Move findMove(const MoveList& moves, int fromIndex, int toIndex);
+std::string moveToString(Move move);
+bool checkLegality(const BoardState& boardState, const MoveList& moves, int fromIndex, int toIndex);
+void makeMove(BoardState& boardState, Move move, UndoStack& history);
+void unmakeMove(BoardState& boardState, Move move, UndoStack& history);
+// Returns true if the position changed since the last call
+bool updatePositionCache(PositionCache& cache, const BoardState& boardState);
+void movePiece(BoardState& boardState, const MoveList& moves, UndoStack& history, int fromIndex, int toIndex);
 
 #endif //CHESS_MOVEMENT_H
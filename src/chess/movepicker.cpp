@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "movepicker.h"
+#include "movement.h"
+
+// The king only needs to outweigh everything else, a capture with it is never answered
+const int seeValues[7] = {0, 100, 320, 330, 500, 900, 20000};
+
+int staticExchange(const BoardState& boardState, Move move)
+{
+        int from = moveFrom(move);
+        int to = moveTo(move);
+        int side = boardState.isWhiteTurn ? WHITE : BLACK;
+        Bitboard occupied = boardState.occupied ^ squareBB(from);
+
+        // gain[d] is what the side making capture d has won if the sequence stops there
+        std::array<int, 33> gain;
+        int pieceOnTarget = getPiece(boardState, from).type;
+        if (moveFlags(move) == MOVE_EN_PASSANT)
+        {
+                gain[0] = seeValues[PAWN];
+                occupied ^= squareBB(side == WHITE ? to + 8 : to - 8);
+        }
+        else
+        {
+                gain[0] = seeValues[getPiece(boardState, to).type];
+        }
+        if (isPromotion(move))
+        {
+                pieceOnTarget = promotionType(move);
+                gain[0] += seeValues[pieceOnTarget] - seeValues[PAWN];
+        }
+
+        Bitboard bishopsQueens = boardState.pieceBB[BISHOP] | boardState.pieceBB[QUEEN];
+        Bitboard rooksQueens = boardState.pieceBB[ROOK] | boardState.pieceBB[QUEEN];
+        Bitboard attackers = attackersTo(boardState, to, occupied) & occupied;
+        int depth = 0;
+        while (true)
+        {
+                side ^= 1;
+                Bitboard sideAttackers = attackers & boardState.colorBB[side];
+                if (!sideAttackers)
+                        break;
+
+                // Always recapture with the least valuable piece
+                int type = PAWN;
+                while (!(sideAttackers & boardState.pieceBB[type]))
+                        type++;
+
+                depth++;
+                gain[depth] = seeValues[pieceOnTarget] - gain[depth - 1];
+                // Neither side can do better by continuing, so capture depth is never made.
+                // This keeps the sign of the result but not always its exact value.
+                if (std::max(-gain[depth - 1], gain[depth]) < 0)
+                {
+                        depth--;
+                        break;
+                }
+
+                occupied ^= squareBB(lsb(sideAttackers & boardState.pieceBB[type]));
+                // Sliders behind the piece that just moved join in
+                if (type == PAWN || type == BISHOP || type == QUEEN)
+                        attackers |= bishopAttacks(to, occupied) & bishopsQueens;
+                if (type == ROOK || type == QUEEN)
+                        attackers |= rookAttacks(to, occupied) & rooksQueens;
+                attackers &= occupied;
+                pieceOnTarget = type;
+        }
+
+        // Each side stops capturing as soon as going on would lose material
+        while (depth > 0)
+        {
+                gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+                depth--;
+        }
+        return gain[0];
+}
+
+void initMovePicker(MovePicker& picker, const BoardState& boardState, const MoveHistory& history, Move ttMove,
+                    const std::array<Move, 2>& killers, Move counterMove, bool inCheck, bool capturesOnly)
+{
+        picker.boardState = &boardState;
+        picker.history = &history;
+        picker.ttMove = ttMove;
+        picker.killers[0] = killers[0];
+        picker.killers[1] = killers[1];
+        picker.counterMove = counterMove;
+        picker.capturesOnly = capturesOnly;
+        if (inCheck)
+                picker.stage = PICK_GENERATE_EVASIONS;
+        else
+                picker.stage = capturesOnly ? PICK_GENERATE_CAPTURES : PICK_TT_MOVE;
+}
+
+// Most valuable victim first, then least valuable attacker
+int captureScore(const BoardState& boardState, Move move)
+{
+        int victim = moveFlags(move) == MOVE_EN_PASSANT ? (int)PAWN : getPiece(boardState, moveTo(move)).type;
+        int score = seeValues[victim] * 16 - getPiece(boardState, moveFrom(move)).type;
+        if (isPromotion(move))
+                score += seeValues[promotionType(move)];
+        return score;
+}
+
+int quietScore(const MovePicker& picker, Move move)
+{
+        return picker.history->butterfly[picker.boardState->isWhiteTurn ? WHITE : BLACK][moveFrom(move)][moveTo(move)];
+}
+
+// Selection sort one step at a time, after a cutoff the rest is never sorted
+Move pickBest(MovePicker& picker)
+{
+        int best = picker.current;
+        for (int i = picker.current + 1; i < picker.moves.count; i++)
+        {
+                if (picker.scores[i] > picker.scores[best])
+                        best = i;
+        }
+        std::swap(picker.moves.moves[best], picker.moves.moves[picker.current]);
+        std::swap(picker.scores[best], picker.scores[picker.current]);
+        return picker.moves.moves[picker.current++];
+}
+
+// A killer or countermove is only tried if it is a quiet move here and was not handed out before
+bool isUsableRefutation(const MovePicker& picker, Move move, int stage)
+{
+        if (move == MOVE_NONE || move == picker.ttMove || isCapture(move) || isPromotion(move))
+                return false;
+        if (stage >= PICK_KILLER_2 && move == picker.killers[0])
+                return false;
+        if (stage == PICK_COUNTERMOVE && move == picker.killers[1])
+                return false;
+        return isPseudoLegal(*picker.boardState, move);
+}
+
+Move nextMove(MovePicker& picker)
+{
+        while (true)
+        {
+                switch (picker.stage)
+                {
+                        case PICK_TT_MOVE:
+                                picker.stage++;
+                                if (picker.ttMove != MOVE_NONE && isPseudoLegal(*picker.boardState, picker.ttMove))
+                                {
+                                        picker.lastStage = PICK_TT_MOVE;
+                                        return picker.ttMove;
+                                }
+                                break;
+
+                        case PICK_GENERATE_CAPTURES:
+                                picker.moves.count = 0;
+                                generateMoves(*picker.boardState, picker.moves, GEN_CAPTURES);
+                                for (int i = 0; i < picker.moves.count; i++)
+                                        picker.scores[i] = captureScore(*picker.boardState, picker.moves.moves[i]);
+                                picker.current = 0;
+                                picker.stage++;
+                                break;
+
+                        case PICK_GOOD_CAPTURES:
+                                while (picker.current < picker.moves.count)
+                                {
+                                        Move move = pickBest(picker);
+                                        if (move == picker.ttMove)
+                                                continue;
+                                        // Exchanges are only resolved for the captures actually reached
+                                        if (staticExchange(*picker.boardState, move) < 0)
+                                        {
+                                                picker.badCaptures.add(move);
+                                                continue;
+                                        }
+                                        picker.lastStage = PICK_GOOD_CAPTURES;
+                                        return move;
+                                }
+                                picker.stage = picker.capturesOnly ? PICK_DONE : PICK_KILLER_1;
+                                break;
+
+                        case PICK_KILLER_1:
+                        case PICK_KILLER_2:
+                        case PICK_COUNTERMOVE:
+                        {
+                                int stage = picker.stage++;
+                                Move move = stage == PICK_COUNTERMOVE ? picker.counterMove : picker.killers[stage - PICK_KILLER_1];
+                                if (isUsableRefutation(picker, move, stage))
+                                {
+                                        picker.lastStage = stage;
+                                        return move;
+                                }
+                                break;
+                        }
+
+                        case PICK_GENERATE_QUIETS:
+                                picker.moves.count = 0;
+                                generateMoves(*picker.boardState, picker.moves, GEN_QUIETS);
+                                for (int i = 0; i < picker.moves.count; i++)
+                                        picker.scores[i] = quietScore(picker, picker.moves.moves[i]);
+                                picker.current = 0;
+                                picker.stage++;
+                                break;
+
+                        case PICK_QUIETS:
+                                while (picker.current < picker.moves.count)
+                                {
+                                        Move move = pickBest(picker);
+                                        if (move == picker.ttMove || move == picker.killers[0] || move == picker.killers[1] ||
+                                            move == picker.counterMove)
+                                                continue;
+                                        picker.lastStage = PICK_QUIETS;
+                                        return move;
+                                }
+                                picker.current = 0;
+                                picker.stage++;
+                                break;
+
+                        case PICK_BAD_CAPTURES:
+                                if (picker.current < picker.badCaptures.count)
+                                {
+                                        picker.lastStage = PICK_BAD_CAPTURES;
+                                        return picker.badCaptures.moves[picker.current++];
+                                }
+                                picker.stage = PICK_DONE;
+                                break;
+
+                        case PICK_GENERATE_EVASIONS:
+                                picker.moves.count = 0;
+                                generateMoves(*picker.boardState, picker.moves, GEN_EVASIONS);
+                                for (int i = 0; i < picker.moves.count; i++)
+                                {
+                                        Move move = picker.moves.moves[i];
+                                        if (move == picker.ttMove)
+                                                picker.scores[i] = 1 << 30;
+                                        else if (isCapture(move) || isPromotion(move))
+                                                picker.scores[i] = (1 << 16) + captureScore(*picker.boardState, move);
+                                        else
+                                                picker.scores[i] = quietScore(picker, move);
+                                }
+                                picker.current = 0;
+                                picker.stage++;
+                                break;
+
+                        case PICK_EVASIONS:
+                                if (picker.current < picker.moves.count)
+                                {
+                                        picker.lastStage = PICK_EVASIONS;
+                                        return pickBest(picker);
+                                }
+                                picker.stage = PICK_DONE;
+                                break;
+
+                        default:
+                                return MOVE_NONE;
+                }
+        }
+}
+
+const char* pickStageName(int stage)
+{
+        switch (stage)
+        {
+                case PICK_TT_MOVE:
+                        return "tt move";
+                case PICK_GOOD_CAPTURES:
+                        return "good captures";
+                case PICK_KILLER_1:
+                        return "killer 1";
+                case PICK_KILLER_2:
+                        return "killer 2";
+                case PICK_COUNTERMOVE:
+                        return "countermove";
+                case PICK_QUIETS:
+                        return "quiets";
+                case PICK_BAD_CAPTURES:
+                        return "bad captures";
+                case PICK_EVASIONS:
+                        return "evasions";
+                default:
+                        return "none";
+        }
+}
+
+// Moves toward the bonus proportionally to how far the entry still is from the limit,
+// so scores stay within HISTORY_MAX and old results fade
+void addHistoryBonus(int& entry, int bonus)
+{
+        entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+}
+
+void updateQuietHistory(MoveHistory& history, bool isWhite, Move move, Move previousMove, const Move* tried, int triedCount, int depth)
+{
+        if (previousMove != MOVE_NONE)
+                history.counterMoves[moveFrom(previousMove)][moveTo(previousMove)] = move;
+
+        int side = isWhite ? WHITE : BLACK;
+        int bonus = std::min(depth * depth, 400);
+        addHistoryBonus(history.butterfly[side][moveFrom(move)][moveTo(move)], bonus);
+        for (int i = 0; i < triedCount; i++)
+                addHistoryBonus(history.butterfly[side][moveFrom(tried[i])][moveTo(tried[i])], -bonus);
+}
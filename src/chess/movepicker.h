@@ -0,0 +1,67 @@
+#ifndef CHESS_MOVEPICKER_H
+#define CHESS_MOVEPICKER_H
+
+#include <array>
+
+#include "gamestate.h"
+#include "move.h"
+
+// Order in which the picker hands out moves outside of check. Moves are only generated when
+// their stage is reached, so a cutoff on an early move skips generating the rest.
+enum PickStage
+{
+        PICK_TT_MOVE = 0,
+        PICK_GENERATE_CAPTURES,
+        PICK_GOOD_CAPTURES,   // captures and promotions that do not lose material, by MVV-LVA
+        PICK_KILLER_1,
+        PICK_KILLER_2,
+        PICK_COUNTERMOVE,
+        PICK_GENERATE_QUIETS,
+        PICK_QUIETS,          // by history score
+        PICK_BAD_CAPTURES,
+        PICK_GENERATE_EVASIONS, // in check every evasion is generated and ordered at once
+        PICK_EVASIONS,
+        PICK_DONE,
+        PICK_STAGES
+};
+
+const int HISTORY_MAX = 16384;
+
+// Quiet move statistics gathered by one search thread
+struct MoveHistory
+{
+        int butterfly[2][64][64] = {};  // side, from, to, raised by cutoffs and lowered by moves that failed to cut
+        Move counterMoves[64][64] = {}; // last quiet move that refuted the previous move, by its from and to
+};
+
+struct MovePicker
+{
+        const BoardState* boardState;
+        const MoveHistory* history;
+        Move ttMove;
+        Move killers[2];
+        Move counterMove;
+        bool capturesOnly; // quiescence, nothing after the good captures
+        int stage;
+        int lastStage = PICK_DONE; // stage of the move returned last
+        MoveList moves;
+        std::array<int, 256> scores;
+        int current = 0;
+        MoveList badCaptures;
+};
+
+// Net material the side to move wins by capturing on the target square of move, assuming
+// both sides keep recapturing with their least valuable attacker while it pays
+int staticExchange(const BoardState& boardState, Move move);
+
+void initMovePicker(MovePicker& picker, const BoardState& boardState, const MoveHistory& history, Move ttMove,
+                    const std::array<Move, 2>& killers, Move counterMove, bool inCheck, bool capturesOnly);
+// Pseudo-legal moves without repeats, MOVE_NONE once every stage is exhausted
+Move nextMove(MovePicker& picker);
+const char* pickStageName(int stage);
+
+// Rewards a quiet move that caused a cutoff and penalizes the quiet moves tried before it,
+// the move also becomes the countermove to previousMove
+void updateQuietHistory(MoveHistory& history, bool isWhite, Move move, Move previousMove, const Move* tried, int triedCount, int depth);
+
+#endif // CHESS_MOVEPICKER_H
@@ -0,0 +1,553 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include "perft.h"
+#include "movement.h"
+#include "fen.h"
+
+struct PerftCase
+{
+        const char* name;
+        const char* fen;
+        int depth;
+        uint64_t expected;
+};
+
+// Known node counts from the chessprogramming wiki perft positions and Martin Sedlak's edge cases
+const PerftCase perftSuite[] = {
+        {"start position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 1, 20},
+        {"start position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3, 8902},
+        {"start position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609},
+        {"start position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6, 119060324},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 1, 48},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690},
+        {"rook endgame en passant pins", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+        {"rook endgame en passant pins", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083},
+        {"promotions", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+        {"promotions", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292},
+        {"promotion with check", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487},
+        {"middlegame", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594},
+        {"illegal en passant #1", "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888},
+        {"illegal en passant #2", "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133},
+        {"en passant checks opponent", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467},
+        {"short castling gives check", "5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072},
+        {"long castling gives check", "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711},
+        {"castling rights", "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206},
+        {"castling prevented", "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476},
+        {"promote out of check", "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001},
+        {"discovered check", "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658},
+        {"promote to give check", "4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342},
+        {"underpromote to give check", "8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683},
+        {"self stalemate", "K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217},
+        {"stalemate and checkmate #1", "8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584},
+        {"stalemate and checkmate #2", "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527},
+};
+
+const std::string perftStartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printPerftSpeed(uint64_t nodes, double seconds)
+{
+        std::cout << "Nodes: " << nodes << "\n";
+        std::cout << "Time: " << seconds << " s\n";
+        std::cout << "Nodes/sec: " << (uint64_t)(nodes / (seconds > 0.0 ? seconds : 1e-9)) << "\n";
+}
+
+int initPerftHash(PerftHash& hash, size_t megabytes)
+{
+        if (megabytes == 0 || megabytes > MAX_PERFT_HASH_MEGABYTES)
+        {
+                std::cerr << "Perft hash size must be between 1 and " << MAX_PERFT_HASH_MEGABYTES << " MB\n";
+                return -1;
+        }
+
+        uint64_t bucketCount = 1;
+        while (bucketCount * 2 * sizeof(PerftHashBucket) <= megabytes * 1024 * 1024)
+                bucketCount *= 2;
+
+        hash.buckets.reset(new (std::nothrow) PerftHashBucket[bucketCount]());
+        if (!hash.buckets)
+        {
+                std::cerr << "Failed to allocate a " << megabytes << " MB perft hash\n";
+                hash.bucketMask = 0;
+                return -1;
+        }
+        hash.bucketMask = bucketCount - 1;
+        return 0;
+}
+
+bool probePerftHash(const PerftHash& hash, uint64_t key, int depth, uint64_t& nodes)
+{
+        const PerftHashBucket& bucket = hash.buckets[key & hash.bucketMask];
+        for (const PerftHashEntry& entry : bucket.entries)
+        {
+                uint64_t data = entry.data.load(std::memory_order_relaxed);
+                uint64_t keyXorData = entry.keyXorData.load(std::memory_order_relaxed);
+                if ((keyXorData ^ data) == key && (int)(data & 0xFF) == depth)
+                {
+                        nodes = data >> 8;
+                        return true;
+                }
+        }
+        return false;
+}
+
+// Replaces the shallowest entry of the bucket, deeper subtrees save more work
+void storePerftHash(PerftHash& hash, uint64_t key, int depth, uint64_t nodes)
+{
+        PerftHashBucket& bucket = hash.buckets[key & hash.bucketMask];
+        PerftHashEntry* replace = &bucket.entries[0];
+        int replaceDepth = 256;
+        for (PerftHashEntry& entry : bucket.entries)
+        {
+                uint64_t data = entry.data.load(std::memory_order_relaxed);
+                int entryDepth = (int)(data & 0xFF);
+                if (entryDepth < replaceDepth)
+                {
+                        replace = &entry;
+                        replaceDepth = entryDepth;
+                }
+        }
+
+        uint64_t data = (nodes << 8) | (uint64_t)depth;
+        replace->data.store(data, std::memory_order_relaxed);
+        replace->keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+void printPerftHashStats(const PerftHash& hash, const PerftHashStats& stats)
+{
+        uint64_t megabytes = (hash.bucketMask + 1) * sizeof(PerftHashBucket) / (1024 * 1024);
+        std::cout << "Hash: " << megabytes << " MB, " << stats.probes << " probes, " << stats.hits << " hits ("
+                  << 100.0 * stats.hits / (stats.probes ? stats.probes : 1) << "%), " << stats.stores << " stores\n";
+}
+
+// Leaf moves are counted rather than made (bulk counting). Subtrees of depth 2 and more
+// go through the hash table when one is given.
+uint64_t perft(BoardState& boardState, UndoStack& history, int depth, PerftHash* hash, PerftHashStats* stats)
+{
+        if (depth <= 0)
+                return 1;
+
+        uint64_t key = 0;
+        uint64_t nodes = 0;
+        if (hash && depth >= 2)
+        {
+                key = boardState.hash;
+                stats->probes++;
+                if (probePerftHash(*hash, key, depth, nodes))
+                {
+                        stats->hits++;
+                        return nodes;
+                }
+        }
+
+        MoveList moves;
+        generateLegalMoves(boardState, moves);
+        if (depth == 1)
+                return moves.count;
+
+        for (Move move : moves)
+        {
+                makeMove(boardState, move, history);
+                nodes += perft(boardState, history, depth - 1, hash, stats);
+                unmakeMove(boardState, move, history);
+        }
+
+        if (hash)
+        {
+                storePerftHash(*hash, key, depth, nodes);
+                stats->stores++;
+        }
+        return nodes;
+}
+
+uint64_t perftDivide(BoardState& boardState, int depth, PerftHash* hash)
+{
+        UndoStack history;
+        PerftHashStats stats;
+        MoveList moves;
+        generateLegalMoves(boardState, moves);
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = 0;
+        for (Move move : moves)
+        {
+                makeMove(boardState, move, history);
+                uint64_t moveNodes = perft(boardState, history, depth - 1, hash, &stats);
+                unmakeMove(boardState, move, history);
+
+                std::cout << moveToString(move) << ": " << moveNodes << "\n";
+                nodes += moveNodes;
+        }
+        std::cout << "\n";
+        printPerftSpeed(nodes, secondsSince(start));
+        if (hash)
+                printPerftHashStats(*hash, stats);
+        return nodes;
+}
+
+int runPerftSuite(int maxDepth)
+{
+        int failed = 0;
+        uint64_t totalNodes = 0;
+        auto suiteStart = std::chrono::steady_clock::now();
+
+        for (const PerftCase& perftCase : perftSuite)
+        {
+                if (perftCase.depth > maxDepth)
+                        continue;
+
+                BoardState boardState;
+                if (applyFEN(perftCase.fen, boardState) != 0)
+                {
+                        std::cerr << "Error parsing FEN: " << perftCase.fen << "\n";
+                        failed++;
+                        continue;
+                }
+
+                UndoStack history;
+                auto start = std::chrono::steady_clock::now();
+                uint64_t nodes = perft(boardState, history, perftCase.depth);
+                double seconds = secondsSince(start);
+                totalNodes += nodes;
+
+                bool passed = nodes == perftCase.expected;
+                if (!passed)
+                        failed++;
+                std::cout << (passed ? "[ OK ] " : "[FAIL] ") << perftCase.name << ", depth " << perftCase.depth
+                          << ": " << nodes;
+                if (!passed)
+                        std::cout << " (expected " << perftCase.expected << ")";
+                std::cout << ", " << (uint64_t)(nodes / (seconds > 0.0 ? seconds : 1e-9)) << " nodes/sec\n";
+        }
+
+        std::cout << "\n";
+        printPerftSpeed(totalNodes, secondsSince(suiteStart));
+        if (failed)
+        {
+                std::cout << "Failed: " << failed << "\n";
+                return -1;
+        }
+        std::cout << "All passed\n";
+        return 0;
+}
+
+struct PerftTask
+{
+        BoardState boardState;
+        int depth;
+        int rootIndex; // root move this subtree belongs to, for divide output
+};
+
+// Each worker owns a deque of task indices. It pops its own work from the back and,
+// once empty, steals from the front of the other workers' deques.
+struct PerftWorker
+{
+        std::deque<int> tasks;
+        std::mutex mutex;
+        uint64_t nodes = 0;
+        int tasksRun = 0;
+        int tasksStolen = 0;
+        double busySeconds = 0.0;
+        PerftHashStats hashStats;
+};
+
+void expandPerftTasks(BoardState& boardState, UndoStack& history, int depth, int splitDepth, int rootIndex, std::vector<PerftTask>& tasks)
+{
+        if (splitDepth == 0 || depth <= 1)
+        {
+                tasks.push_back({boardState, depth, rootIndex});
+                return;
+        }
+
+        MoveList moves;
+        generateLegalMoves(boardState, moves);
+        for (Move move : moves)
+        {
+                makeMove(boardState, move, history);
+                expandPerftTasks(boardState, history, depth - 1, splitDepth - 1, rootIndex, tasks);
+                unmakeMove(boardState, move, history);
+        }
+}
+
+bool takePerftTask(std::vector<PerftWorker>& workers, int self, int& taskIndex, bool& stolen)
+{
+        {
+                std::lock_guard<std::mutex> lock(workers[self].mutex);
+                if (!workers[self].tasks.empty())
+                {
+                        taskIndex = workers[self].tasks.back();
+                        workers[self].tasks.pop_back();
+                        stolen = false;
+                        return true;
+                }
+        }
+
+        for (size_t offset = 1; offset < workers.size(); offset++)
+        {
+                PerftWorker& victim = workers[(self + offset) % workers.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty())
+                {
+                        taskIndex = victim.tasks.front();
+                        victim.tasks.pop_front();
+                        stolen = true;
+                        return true;
+                }
+        }
+        return false;
+}
+
+void runPerftWorker(std::vector<PerftWorker>& workers, int self, const std::vector<PerftTask>& tasks, std::vector<uint64_t>& taskNodes, PerftHash* hash)
+{
+        PerftWorker& worker = workers[self];
+        BoardState boardState;
+        UndoStack history;
+        auto start = std::chrono::steady_clock::now();
+
+        int taskIndex;
+        bool stolen;
+        while (takePerftTask(workers, self, taskIndex, stolen))
+        {
+                boardState = tasks[taskIndex].boardState;
+                uint64_t nodes = perft(boardState, history, tasks[taskIndex].depth, hash, &worker.hashStats);
+                taskNodes[taskIndex] = nodes;
+                worker.nodes += nodes;
+                worker.tasksRun++;
+                worker.tasksStolen += stolen ? 1 : 0;
+        }
+        worker.busySeconds = secondsSince(start);
+}
+
+uint64_t parallelPerft(BoardState& boardState, int depth, int numThreads, int splitDepth, bool divide, bool baseline, PerftHash* hash)
+{
+        // Nothing to split, and the tasks below assume at least one ply
+        if (depth < 1)
+                return 1;
+
+        MoveList rootMoves;
+        generateLegalMoves(boardState, rootMoves);
+        if (depth < 2 || rootMoves.count == 0)
+        {
+                UndoStack history;
+                return perft(boardState, history, depth);
+        }
+
+        // By default split below the root as well when there are too few root moves to go around
+        if (splitDepth <= 0)
+                splitDepth = rootMoves.count >= numThreads * 4 ? 1 : 2;
+        if (splitDepth > depth - 1)
+                splitDepth = depth - 1;
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<PerftTask> tasks;
+        UndoStack history;
+        for (int i = 0; i < rootMoves.count; i++)
+        {
+                makeMove(boardState, rootMoves.moves[i], history);
+                expandPerftTasks(boardState, history, depth - 1, splitDepth - 1, i, tasks);
+                unmakeMove(boardState, rootMoves.moves[i], history);
+        }
+
+        std::vector<PerftWorker> workers(numThreads);
+        for (size_t i = 0; i < tasks.size(); i++)
+                workers[i % numThreads].tasks.push_back(i);
+
+        std::vector<uint64_t> taskNodes(tasks.size(), 0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < numThreads; i++)
+                threads.emplace_back(runPerftWorker, std::ref(workers), i, std::cref(tasks), std::ref(taskNodes), hash);
+        for (std::thread& thread : threads)
+                thread.join();
+
+        double seconds = secondsSince(start);
+
+        std::vector<uint64_t> rootNodes(rootMoves.count, 0);
+        uint64_t nodes = 0;
+        for (size_t i = 0; i < tasks.size(); i++)
+        {
+                rootNodes[tasks[i].rootIndex] += taskNodes[i];
+                nodes += taskNodes[i];
+        }
+
+        if (divide)
+        {
+                for (int i = 0; i < rootMoves.count; i++)
+                        std::cout << moveToString(rootMoves.moves[i]) << ": " << rootNodes[i] << "\n";
+                std::cout << "\n";
+        }
+
+        std::cout << "Threads: " << numThreads << ", tasks: " << tasks.size() << " (split depth " << splitDepth << ")\n";
+        double busySeconds = 0.0;
+        PerftHashStats hashStats;
+        for (int i = 0; i < numThreads; i++)
+        {
+                const PerftWorker& worker = workers[i];
+                busySeconds += worker.busySeconds;
+                hashStats.probes += worker.hashStats.probes;
+                hashStats.hits += worker.hashStats.hits;
+                hashStats.stores += worker.hashStats.stores;
+                std::cout << "Thread " << i << ": " << worker.nodes << " nodes, " << worker.tasksRun << " tasks ("
+                          << worker.tasksStolen << " stolen), "
+                          << (uint64_t)(worker.nodes / (worker.busySeconds > 0.0 ? worker.busySeconds : 1e-9)) << " nodes/sec\n";
+        }
+
+        printPerftSpeed(nodes, seconds);
+        // Share of the wall time the workers spent before running out of tasks
+        std::cout << "Thread utilization: " << 100.0 * busySeconds / (numThreads * (seconds > 0.0 ? seconds : 1e-9)) << "%\n";
+        if (hash)
+                printPerftHashStats(*hash, hashStats);
+
+        if (baseline)
+        {
+                UndoStack baselineHistory;
+                auto baselineStart = std::chrono::steady_clock::now();
+                PerftHashStats baselineStats;
+                if (hash)
+                        initPerftHash(*hash, (hash->bucketMask + 1) * sizeof(PerftHashBucket) / (1024 * 1024));
+                perft(boardState, baselineHistory, depth, hash, &baselineStats);
+                double speedup = secondsSince(baselineStart) / (seconds > 0.0 ? seconds : 1e-9);
+                std::cout << "Speedup over 1 thread: " << speedup << "x\n";
+                std::cout << "Scaling efficiency: " << 100.0 * speedup / numThreads << "%\n";
+        }
+
+        if ((unsigned)numThreads > std::thread::hardware_concurrency())
+                std::cout << "Warning: more threads than the " << std::thread::hardware_concurrency() << " hardware threads\n";
+        return nodes;
+}
+
+void printPerftUsage(const char* program)
+{
+        std::cerr << "Usage: " << program << " perft <depth> [fen] | divide <depth> [fen] | perft suite [max depth]\n"
+                  << "       depth from 1 to " << MAX_PERFT_DEPTH << "\n"
+                  << "       [--threads <n, 0 for all cores>] [--split <plies expanded into tasks>] [--baseline]\n"
+                  << "       [--hash <MB>]\n";
+}
+
+int perftCommand(int argc, char** argv)
+{
+        int numThreads = 1;
+        int splitDepth = 0;
+        bool baseline = false;
+        size_t hashMegabytes = 0;
+        int suiteDepth = 99;
+        int depth = 0;
+        std::vector<std::string> args;
+        try
+        {
+                for (int i = 1; i < argc; i++)
+                {
+                        std::string arg = argv[i];
+                        if (arg == "--threads" || arg == "--split" || arg == "--hash")
+                        {
+                                if (i + 1 >= argc)
+                                {
+                                        printPerftUsage(argv[0]);
+                                        return -1;
+                                }
+                                int value = std::stoi(argv[++i]);
+                                if (arg == "--threads")
+                                        numThreads = value > 0 ? value : (int)std::thread::hardware_concurrency();
+                                else if (arg == "--split")
+                                        splitDepth = value;
+                                else if (value >= 0)
+                                        hashMegabytes = value;
+                                else
+                                {
+                                        printPerftUsage(argv[0]);
+                                        return -1;
+                                }
+                        }
+                        else if (arg == "--baseline")
+                        {
+                                baseline = true;
+                        }
+                        else
+                        {
+                                args.push_back(arg);
+                        }
+                }
+
+                if (args.size() > 1 && args[1] == "suite")
+                        suiteDepth = args.size() > 2 ? std::stoi(args[2]) : 99;
+                else if (args.size() > 1)
+                        depth = std::stoi(args[1]);
+        }
+        catch (const std::invalid_argument& e)
+        {
+                printPerftUsage(argv[0]);
+                return -1;
+        }
+        catch (const std::out_of_range& e)
+        {
+                printPerftUsage(argv[0]);
+                return -1;
+        }
+
+        std::string command = args[0];
+        if (command == "perft" && args.size() > 1 && args[1] == "suite")
+                return runPerftSuite(suiteDepth);
+
+        // perft() treats any depth below 1 as a leaf, divide needs at least one ply to split
+        if (args.size() < 2 || depth < 1 || depth > MAX_PERFT_DEPTH)
+        {
+                printPerftUsage(argv[0]);
+                return -1;
+        }
+
+        std::string fen = perftStartFEN;
+        if (args.size() > 2)
+        {
+                fen = args[2];
+                for (size_t i = 3; i < args.size(); i++)
+                        fen += " " + args[i];
+        }
+
+        BoardState boardState;
+        if (applyFEN(fen, boardState) != 0)
+        {
+                std::cerr << "Error parsing FEN\n";
+                return -1;
+        }
+
+        PerftHash hash;
+        if (hashMegabytes > 0 && initPerftHash(hash, hashMegabytes) != 0)
+                return -1;
+        PerftHash* hashPointer = hashMegabytes > 0 ? &hash : nullptr;
+
+        // A single ply has nothing to split, the sequential path below also prints the result
+        if (numThreads > 1 && depth >= 2)
+        {
+                parallelPerft(boardState, depth, numThreads, splitDepth, command == "divide", baseline, hashPointer);
+                return 0;
+        }
+
+        if (command == "divide")
+        {
+                perftDivide(boardState, depth, hashPointer);
+                return 0;
+        }
+
+        UndoStack history;
+        PerftHashStats stats;
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = perft(boardState, history, depth, hashPointer, &stats);
+        printPerftSpeed(nodes, secondsSince(start));
+        if (hashPointer)
+                printPerftHashStats(hash, stats);
+        return 0;
+}
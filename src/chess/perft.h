@@ -0,0 +1,60 @@
+#ifndef CHESS_PERFT_H
+#define CHESS_PERFT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "gamestate.h"
+#include "move.h"
+
+// The hash packs the depth into 8 bits and every ply needs an undo record, deeper
+// trees could not be counted before the end of time anyway
+const int MAX_PERFT_DEPTH = 64;
+// Keeps the size in bytes far from overflowing
+const size_t MAX_PERFT_HASH_MEGABYTES = 1 << 20;
+
+// Entries are written without locks. The key is stored XORed with the data, so a torn
+// write from another thread fails the key check instead of returning a wrong count.
+struct PerftHashEntry
+{
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data; // node count << 8 | depth
+};
+
+struct PerftHashBucket
+{
+        PerftHashEntry entries[4]; // one cache line
+};
+
+struct PerftHash
+{
+        std::unique_ptr<PerftHashBucket[]> buckets;
+        uint64_t bucketMask = 0;
+};
+
+// Kept per thread so that counting does not contend
+struct PerftHashStats
+{
+        uint64_t probes = 0;
+        uint64_t hits = 0;
+        uint64_t stores = 0;
+};
+
+int initPerftHash(PerftHash& hash, size_t megabytes);
+void printPerftHashStats(const PerftHash& hash, const PerftHashStats& stats);
+
+uint64_t perft(BoardState& boardState, UndoStack& history, int depth, PerftHash* hash = nullptr, PerftHashStats* stats = nullptr);
+uint64_t perftDivide(BoardState& boardState, int depth, PerftHash* hash = nullptr);
+// splitDepth is the number of plies expanded into tasks, 0 picks one from the root move count.
+// baseline also times a single-threaded run to report the speedup.
+uint64_t parallelPerft(BoardState& boardState, int depth, int numThreads, int splitDepth, bool divide, bool baseline, PerftHash* hash = nullptr);
+int runPerftSuite(int maxDepth);
+
+// perft <depth> [fen], divide <depth> [fen] or perft suite [max depth],
+// optionally with --threads <n>, --split <plies>, --baseline and --hash <MB>.
+// Returns -1 after printing the usage for a missing or invalid value or a depth outside 1 to MAX_PERFT_DEPTH.
+int perftCommand(int argc, char** argv);
+
+#endif // CHESS_PERFT_H
@@ -0,0 +1,719 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search.h"
+#include "movement.h"
+#include "fen.h"
+
+const int pieceValues[7] = {0, 100, 320, 330, 500, 900, 0};
+
+// Piece-square tables from white's point of view, a8 first, the same layout as the board.
+// Black uses the square mirrored vertically (square ^ 56).
+const int pieceSquareTables[7][64] = {
+        {0},
+        { // pawn
+                 0,  0,  0,  0,  0,  0,  0,  0,
+                50, 50, 50, 50, 50, 50, 50, 50,
+                10, 10, 20, 30, 30, 20, 10, 10,
+                 5,  5, 10, 25, 25, 10,  5,  5,
+                 0,  0,  0, 20, 20,  0,  0,  0,
+                 5, -5,-10,  0,  0,-10, -5,  5,
+                 5, 10, 10,-20,-20, 10, 10,  5,
+                 0,  0,  0,  0,  0,  0,  0,  0
+        },
+        { // knight
+                -50,-40,-30,-30,-30,-30,-40,-50,
+                -40,-20,  0,  0,  0,  0,-20,-40,
+                -30,  0, 10, 15, 15, 10,  0,-30,
+                -30,  5, 15, 20, 20, 15,  5,-30,
+                -30,  0, 15, 20, 20, 15,  0,-30,
+                -30,  5, 10, 15, 15, 10,  5,-30,
+                -40,-20,  0,  5,  5,  0,-20,-40,
+                -50,-40,-30,-30,-30,-30,-40,-50
+        },
+        { // bishop
+                -20,-10,-10,-10,-10,-10,-10,-20,
+                -10,  0,  0,  0,  0,  0,  0,-10,
+                -10,  0,  5, 10, 10,  5,  0,-10,
+                -10,  5,  5, 10, 10,  5,  5,-10,
+                -10,  0, 10, 10, 10, 10,  0,-10,
+                -10, 10, 10, 10, 10, 10, 10,-10,
+                -10,  5,  0,  0,  0,  0,  5,-10,
+                -20,-10,-10,-10,-10,-10,-10,-20
+        },
+        { // rook
+                 0,  0,  0,  0,  0,  0,  0,  0,
+                 5, 10, 10, 10, 10, 10, 10,  5,
+                -5,  0,  0,  0,  0,  0,  0, -5,
+                -5,  0,  0,  0,  0,  0,  0, -5,
+                -5,  0,  0,  0,  0,  0,  0, -5,
+                -5,  0,  0,  0,  0,  0,  0, -5,
+                -5,  0,  0,  0,  0,  0,  0, -5,
+                 0,  0,  0,  5,  5,  0,  0,  0
+        },
+        { // queen
+                -20,-10,-10, -5, -5,-10,-10,-20,
+                -10,  0,  0,  0,  0,  0,  0,-10,
+                -10,  0,  5,  5,  5,  5,  0,-10,
+                 -5,  0,  5,  5,  5,  5,  0, -5,
+                  0,  0,  5,  5,  5,  5,  0, -5,
+                -10,  5,  5,  5,  5,  5,  0,-10,
+                -10,  0,  5,  0,  0,  0,  0,-10,
+                -20,-10,-10, -5, -5,-10,-10,-20
+        },
+        { // king, middlegame
+                -30,-40,-40,-50,-50,-40,-40,-30,
+                -30,-40,-40,-50,-50,-40,-40,-30,
+                -30,-40,-40,-50,-50,-40,-40,-30,
+                -30,-40,-40,-50,-50,-40,-40,-30,
+                -20,-30,-30,-40,-40,-30,-30,-20,
+                -10,-20,-20,-20,-20,-20,-20,-10,
+                 20, 20,  0,  0,  0,  0, 20, 20,
+                 20, 30, 10,  0,  0, 10, 30, 20
+        }
+};
+
+int evaluate(const BoardState& boardState)
+{
+        int score = 0;
+        for (int type = PAWN; type <= KING; type++)
+        {
+                Bitboard white = boardState.pieceBB[type] & boardState.colorBB[WHITE];
+                Bitboard black = boardState.pieceBB[type] & boardState.colorBB[BLACK];
+                score += pieceValues[type] * (popCount(white) - popCount(black));
+                while (white)
+                        score += pieceSquareTables[type][popLSB(white)];
+                while (black)
+                        score -= pieceSquareTables[type][popLSB(black) ^ 56];
+        }
+        return boardState.isWhiteTurn ? score : -score;
+}
+
+bool inCheck(const BoardState& boardState)
+{
+        Bitboard king = boardState.pieceBB[KING] & boardState.colorBB[boardState.isWhiteTurn ? WHITE : BLACK];
+        return king && isSquareAttacked(boardState, lsb(king), !boardState.isWhiteTurn);
+}
+
+// Fifty-move rule or a repetition since the last irreversible move, the undo
+// records hold the hash of every earlier position
+bool isDraw(const SearchState& state)
+{
+        const BoardState& boardState = state.boardState;
+        if (boardState.halfMoveClock >= 100)
+                return true;
+
+        int earliest = state.history.size - boardState.halfMoveClock;
+        for (int i = state.history.size - 2; i >= 0 && i >= earliest; i -= 2)
+        {
+                if (state.history.entries[i].hash == boardState.hash)
+                        return true;
+        }
+        return false;
+}
+
+// Called every 2048 nodes, helpers only watch for the main thread's stop
+void checkLimits(SearchState& state)
+{
+        uint64_t totalNodes = state.shared->nodes.fetch_add(2048, std::memory_order_relaxed) + 2048;
+        if (state.shared->stop.load(std::memory_order_relaxed))
+                state.stopped = true;
+        if (state.threadIndex != 0)
+                return;
+
+        if (state.limits.nodes && totalNodes >= state.limits.nodes)
+                state.stopped = true;
+        if (state.limits.moveTimeMs &&
+            std::chrono::steady_clock::now() - state.start >= std::chrono::milliseconds(state.limits.moveTimeMs))
+                state.stopped = true;
+        if (state.stopped)
+                state.shared->stop.store(true, std::memory_order_relaxed);
+}
+
+// Captures and promotions only, until the position is quiet. Losing captures are skipped,
+// in check every evasion is searched since standing pat is not an option.
+int quiescence(SearchState& state, int ply, int alpha, int beta)
+{
+        state.pvLength[ply] = ply;
+
+        if ((++state.nodes & 2047) == 0)
+                checkLimits(state);
+        if (state.stopped)
+                return 0;
+
+        if (isDraw(state))
+                return 0;
+        if (ply >= MAX_SEARCH_PLY - 1)
+                return evaluate(state.boardState);
+
+        bool checked = inCheck(state.boardState);
+        int bestScore = -SCORE_INFINITE;
+        if (!checked)
+        {
+                bestScore = evaluate(state.boardState);
+                if (bestScore >= beta)
+                        return bestScore;
+                if (bestScore > alpha)
+                        alpha = bestScore;
+        }
+
+        // The picker stops before the losing captures
+        MovePicker picker;
+        initMovePicker(picker, state.boardState, state.moveHistory, MOVE_NONE, {MOVE_NONE, MOVE_NONE}, MOVE_NONE, checked, true);
+        Bitboard pinned = pinnedPieces(state.boardState, state.boardState.isWhiteTurn);
+
+        int legalMoves = 0;
+        Move move;
+        while ((move = nextMove(picker)) != MOVE_NONE)
+        {
+                if (!isLegal(state.boardState, move, pinned))
+                        continue;
+                legalMoves++;
+
+                makeMove(state.boardState, move, state.history);
+                int score = -quiescence(state, ply + 1, -beta, -alpha);
+                unmakeMove(state.boardState, move, state.history);
+
+                if (state.stopped)
+                        return 0;
+
+                if (score > bestScore)
+                {
+                        bestScore = score;
+                        if (score > alpha)
+                                alpha = score;
+                }
+                if (alpha >= beta)
+                        break;
+        }
+
+        if (checked && legalMoves == 0)
+                return -SCORE_MATE + ply;
+        return bestScore;
+}
+
+int negamax(SearchState& state, int depth, int ply, int alpha, int beta)
+{
+        if (depth <= 0)
+                return quiescence(state, ply, alpha, beta);
+
+        state.pvLength[ply] = ply;
+
+        if ((++state.nodes & 2047) == 0)
+                checkLimits(state);
+        if (state.stopped)
+                return 0;
+
+        if (ply > 0 && isDraw(state))
+                return 0;
+        if (ply >= MAX_SEARCH_PLY - 1)
+                return evaluate(state.boardState);
+
+        // Only zero-window nodes take cutoffs from the table, PV nodes are searched
+        // fully so that the reported line stays complete
+        bool pvNode = beta - alpha > 1;
+        Move ttMove = MOVE_NONE;
+        TTProbe probe;
+        if (state.tt && probeTT(*state.tt, state.boardState.hash, ply, probe, state.ttStats))
+        {
+                ttMove = probe.move;
+                if (!pvNode && ply > 0 && probe.depth >= depth &&
+                    (probe.bound == BOUND_EXACT ||
+                     (probe.bound == BOUND_LOWER && probe.score >= beta) ||
+                     (probe.bound == BOUND_UPPER && probe.score <= alpha)))
+                        return probe.score;
+        }
+
+        // The previous iteration's PV move takes the place of the table move while on the PV
+        bool onPV = state.followPV;
+        Move pvMove = onPV && ply < state.previousPVLength ? state.previousPV[ply] : MOVE_NONE;
+        Move previousMove = ply > 0 ? state.moveStack[ply - 1] : MOVE_NONE;
+        Move counterMove = previousMove != MOVE_NONE ? state.moveHistory.counterMoves[moveFrom(previousMove)][moveTo(previousMove)] : MOVE_NONE;
+        bool checked = inCheck(state.boardState);
+        MovePicker picker;
+        initMovePicker(picker, state.boardState, state.moveHistory, pvMove != MOVE_NONE ? pvMove : ttMove, state.killers[ply],
+                       counterMove, checked, false);
+        Bitboard pinned = pinnedPieces(state.boardState, state.boardState.isWhiteTurn);
+
+        int originalAlpha = alpha;
+        int bestScore = -SCORE_INFINITE;
+        Move bestMove = MOVE_NONE;
+        int legalMoves = 0;
+        // Quiet moves that failed to cut, penalized if a later quiet move does
+        std::array<Move, 64> quietsTried;
+        int quietCount = 0;
+        Move move;
+        while ((move = nextMove(picker)) != MOVE_NONE)
+        {
+                if (!isLegal(state.boardState, move, pinned))
+                        continue;
+                state.followPV = onPV && legalMoves == 0 && move == pvMove;
+                legalMoves++;
+                bool quiet = !isCapture(move) && !isPromotion(move);
+
+                // Later moves only have to be proven worse than the first, a zero window does
+                // that cheaply and the move is searched again with the full window if it fails high
+                state.moveStack[ply] = move;
+                makeMove(state.boardState, move, state.history);
+                int score;
+                if (legalMoves == 1)
+                        score = -negamax(state, depth - 1, ply + 1, -beta, -alpha);
+                else
+                {
+                        score = -negamax(state, depth - 1, ply + 1, -alpha - 1, -alpha);
+                        if (score > alpha && score < beta && !state.stopped)
+                                score = -negamax(state, depth - 1, ply + 1, -beta, -alpha);
+                }
+                unmakeMove(state.boardState, move, state.history);
+
+                if (state.stopped)
+                        return 0;
+
+                if (score > bestScore)
+                {
+                        bestScore = score;
+                        bestMove = move;
+                        if (score > alpha)
+                        {
+                                alpha = score;
+                                state.pvTable[ply][ply] = move;
+                                for (int next = ply + 1; next < state.pvLength[ply + 1]; next++)
+                                        state.pvTable[ply][next] = state.pvTable[ply + 1][next];
+                                state.pvLength[ply] = state.pvLength[ply + 1];
+                        }
+                }
+                if (alpha >= beta)
+                {
+                        state.cutoffStats.cutoffs++;
+                        if (legalMoves == 1)
+                                state.cutoffStats.firstMove++;
+                        state.cutoffStats.byStage[picker.lastStage]++;
+                        if (quiet)
+                        {
+                                if (state.killers[ply][0] != move)
+                                {
+                                        state.killers[ply][1] = state.killers[ply][0];
+                                        state.killers[ply][0] = move;
+                                }
+                                updateQuietHistory(state.moveHistory, state.boardState.isWhiteTurn, move, previousMove,
+                                                   quietsTried.data(), quietCount, depth);
+                        }
+                        break;
+                }
+                if (quiet && quietCount < (int)quietsTried.size())
+                        quietsTried[quietCount++] = move;
+        }
+        state.followPV = false;
+
+        if (legalMoves == 0)
+                return checked ? -SCORE_MATE + ply : 0;
+
+        if (state.tt)
+        {
+                int bound = bestScore >= beta ? BOUND_LOWER : bestScore > originalAlpha ? BOUND_EXACT : BOUND_UPPER;
+                // A fail-low node has no best move worth remembering
+                storeTT(*state.tt, state.boardState.hash, ply, bound == BOUND_UPPER ? MOVE_NONE : bestMove, bestScore, depth, bound, state.ttStats);
+        }
+
+        return bestScore;
+}
+
+std::string scoreToString(int score)
+{
+        if (score >= SCORE_MATE - MAX_SEARCH_PLY)
+                return "mate " + std::to_string((SCORE_MATE - score + 1) / 2);
+        if (score <= -SCORE_MATE + MAX_SEARCH_PLY)
+                return "mate -" + std::to_string((SCORE_MATE + score) / 2);
+        return "cp " + std::to_string(score);
+}
+
+void addCutoffStats(CutoffStats& total, const CutoffStats& stats)
+{
+        total.cutoffs += stats.cutoffs;
+        total.firstMove += stats.firstMove;
+        for (int stage = 0; stage < PICK_STAGES; stage++)
+                total.byStage[stage] += stats.byStage[stage];
+}
+
+void printCutoffStats(const CutoffStats& stats)
+{
+        double cutoffs = stats.cutoffs ? (double)stats.cutoffs : 1.0;
+        std::cout << "Cutoffs: " << stats.cutoffs << ", on the first move " << 100.0 * stats.firstMove / cutoffs << "%, by stage:";
+        for (int stage = 0; stage < PICK_STAGES; stage++)
+        {
+                if (stats.byStage[stage])
+                        std::cout << " " << pickStageName(stage) << " " << 100.0 * stats.byStage[stage] / cutoffs << "%";
+        }
+        std::cout << "\n";
+}
+
+// Helper threads skip some depths so that they work ahead of the main thread instead of
+// repeating its iterations, thread i uses row (i - 1) % 20: depth d is skipped when
+// (d + phase) / size is odd
+const int skipSize[20] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+const int skipPhase[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+void iterativeDeepening(SearchState& state, bool report)
+{
+        SearchResult& result = state.completed;
+        int maxDepth = state.limits.depth > 0 && state.limits.depth < MAX_SEARCH_PLY ? state.limits.depth : MAX_SEARCH_PLY - 1;
+        for (int depth = 1; depth <= maxDepth; depth++)
+        {
+                if (state.threadIndex > 0)
+                {
+                        int row = (state.threadIndex - 1) % 20;
+                        if ((depth + skipPhase[row]) / skipSize[row] % 2 != 0)
+                                continue;
+                }
+
+                state.followPV = true;
+                int score = negamax(state, depth, 0, -SCORE_INFINITE, SCORE_INFINITE);
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - state.start).count();
+
+                // An interrupted iteration is discarded, its moves were not all searched
+                if (state.stopped)
+                        break;
+
+                result.score = score;
+                result.depth = depth;
+                result.pvLength = state.pvLength[0];
+                for (int i = 0; i < result.pvLength; i++)
+                        result.pv[i] = state.pvTable[0][i];
+                if (result.pvLength > 0)
+                        result.bestMove = result.pv[0];
+
+                std::copy(result.pv.begin(), result.pv.begin() + result.pvLength, state.previousPV.begin());
+                state.previousPVLength = result.pvLength;
+
+                if (report)
+                {
+                        uint64_t nodes = state.shared->nodes.load(std::memory_order_relaxed) + (state.nodes & 2047);
+                        std::cout << "depth " << depth << " score " << scoreToString(score) << " nodes " << nodes
+                                  << " nps " << (uint64_t)(nodes / (seconds > 0.0 ? seconds : 1e-9))
+                                  << " time " << (int64_t)(seconds * 1000) << " pv";
+                        for (int i = 0; i < result.pvLength; i++)
+                                std::cout << " " << moveToString(result.pv[i]);
+                        std::cout << std::endl;
+                }
+
+                // No deeper search can change a forced mate
+                if (score >= SCORE_MATE - depth || score <= -SCORE_MATE + depth)
+                        break;
+        }
+}
+
+SearchResult search(const BoardState& boardState, const SearchLimits& limits, bool report, TranspositionTable* tt, int numThreads)
+{
+        auto start = std::chrono::steady_clock::now();
+        SearchResult result;
+        MoveList rootMoves;
+        generateLegalMoves(boardState, rootMoves);
+        if (rootMoves.count == 0)
+                return result;
+
+        if (tt)
+                newSearch(*tt);
+        if (numThreads < 1)
+                numThreads = 1;
+
+        // The PV table alone is 8 KB, keep the states off the stack
+        SharedSearch shared;
+        std::vector<std::unique_ptr<SearchState>> states;
+        for (int i = 0; i < numThreads; i++)
+        {
+                states.emplace_back(new SearchState());
+                SearchState& state = *states.back();
+                state.threadIndex = i;
+                state.shared = &shared;
+                state.boardState = boardState;
+                state.limits = limits;
+                state.start = start;
+                state.tt = tt;
+                state.completed.bestMove = rootMoves.moves[0];
+        }
+
+        std::vector<std::thread> helpers;
+        for (int i = 1; i < numThreads; i++)
+                helpers.emplace_back(iterativeDeepening, std::ref(*states[i]), false);
+        iterativeDeepening(*states[0], report);
+
+        // The main thread is done, whether by a limit or by reaching its depth
+        shared.stop.store(true, std::memory_order_relaxed);
+        for (std::thread& helper : helpers)
+                helper.join();
+
+        // A helper that finished a deeper iteration than the main thread has the better answer
+        const SearchState* best = states[0].get();
+        for (const std::unique_ptr<SearchState>& state : states)
+        {
+                if (state->completed.depth > best->completed.depth)
+                        best = state.get();
+        }
+        result = best->completed;
+        for (const std::unique_ptr<SearchState>& state : states)
+        {
+                result.nodes += state->nodes;
+                result.ttStats.probes += state->ttStats.probes;
+                result.ttStats.hits += state->ttStats.hits;
+                result.ttStats.stores += state->ttStats.stores;
+                result.ttStats.collisions += state->ttStats.collisions;
+                addCutoffStats(result.cutoffStats, state->cutoffStats);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+}
+
+// Opening, middlegame and endgame positions, each searched from an empty table
+const char* const benchPositions[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R1BQK2R w KQ - 0 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "8/5pk1/6p1/3R4/7P/6P1/r4P2/6K1 w - - 0 40",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"
+};
+
+int runSearchScaling(int depth, int maxThreads, size_t hashMegabytes)
+{
+        std::vector<BoardState> positions;
+        for (const char* fen : benchPositions)
+        {
+                BoardState boardState;
+                if (applyFEN(fen, boardState) != 0)
+                {
+                        std::cerr << "Error parsing FEN: " << fen << "\n";
+                        return -1;
+                }
+                positions.push_back(boardState);
+        }
+
+        TranspositionTable tt;
+        if (initTranspositionTable(tt, hashMegabytes, false) != 0)
+                return -1;
+
+        SearchLimits limits;
+        limits.depth = depth;
+        std::cout << "Time to depth " << depth << " over " << positions.size() << " positions, " << hashMegabytes << " MB table\n";
+        double baselineSeconds = 0;
+        for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+        {
+                double seconds = 0;
+                uint64_t nodes = 0;
+                for (const BoardState& boardState : positions)
+                {
+                        clearTranspositionTable(tt);
+                        SearchResult result = search(boardState, limits, false, &tt, numThreads);
+                        seconds += result.seconds;
+                        nodes += result.nodes;
+                }
+                if (numThreads == 1)
+                        baselineSeconds = seconds;
+
+                double speedup = baselineSeconds / (seconds > 0.0 ? seconds : 1e-9);
+                std::cout << numThreads << " threads: " << (int64_t)(seconds * 1000) << " ms, " << nodes << " nodes, "
+                          << (uint64_t)(nodes / (seconds > 0.0 ? seconds : 1e-9)) << " nodes/sec, speedup " << speedup
+                          << "x, efficiency " << 100.0 * speedup / numThreads << "%\n";
+        }
+
+        if ((unsigned)maxThreads > std::thread::hardware_concurrency())
+                std::cout << "Warning: more threads than the " << std::thread::hardware_concurrency() << " hardware threads\n";
+        freeTranspositionTable(tt);
+        return 0;
+}
+
+void printSearchUsage(const char* program)
+{
+        std::cerr << "Usage: " << program << " search [--depth <n>] [--nodes <n>] [--movetime <ms>] [--threads <n, 0 for all cores>]\n"
+                  << "       [--hash <MB, 0 for none>] [--hugepages] [fen]\n"
+                  << "       " << program << " search scaling [--depth <n>] [--threads <max threads>] [--hash <MB>]\n";
+}
+
+int searchCommand(int argc, char** argv)
+{
+        SearchLimits limits;
+        std::vector<std::string> fenParts;
+        bool depthGiven = false;
+        size_t hashMegabytes = 16;
+        bool hugePages = false;
+        int numThreads = 1;
+        bool threadsGiven = false;
+        try
+        {
+                for (int i = 2; i < argc; i++)
+                {
+                        std::string arg = argv[i];
+                        if (arg == "--hugepages")
+                        {
+                                hugePages = true;
+                        }
+                        else if ((arg == "--depth" || arg == "--nodes" || arg == "--movetime" || arg == "--threads" || arg == "--hash") &&
+                                 i + 1 < argc)
+                        {
+                                // Negative limits would otherwise wrap around to no limit at all
+                                long long value = std::stoll(argv[++i]);
+                                if (value < 0 || (arg == "--depth" && value < 1))
+                                {
+                                        printSearchUsage(argv[0]);
+                                        return -1;
+                                }
+
+                                if (arg == "--depth")
+                                {
+                                        limits.depth = value < MAX_SEARCH_PLY ? (int)value : MAX_SEARCH_PLY - 1;
+                                        depthGiven = true;
+                                }
+                                else if (arg == "--nodes")
+                                        limits.nodes = (uint64_t)value;
+                                else if (arg == "--movetime")
+                                        limits.moveTimeMs = value;
+                                else if (arg == "--threads")
+                                {
+                                        numThreads = value > 0 ? (int)std::min<long long>(value, 1024) : (int)std::thread::hardware_concurrency();
+                                        threadsGiven = true;
+                                }
+                                else
+                                        hashMegabytes = (size_t)value;
+                        }
+                        else
+                        {
+                                fenParts.push_back(arg);
+                        }
+                }
+        }
+        catch (const std::invalid_argument& e)
+        {
+                printSearchUsage(argv[0]);
+                return -1;
+        }
+        catch (const std::out_of_range& e)
+        {
+                printSearchUsage(argv[0]);
+                return -1;
+        }
+
+        if (!fenParts.empty() && fenParts[0] == "scaling")
+                return runSearchScaling(depthGiven ? limits.depth : 7, threadsGiven ? numThreads : 32, hashMegabytes > 0 ? hashMegabytes : 16);
+
+        // Without any limit, think for a few seconds rather than forever
+        if (!depthGiven && !limits.nodes && !limits.moveTimeMs)
+                limits.moveTimeMs = 5000;
+
+        std::string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+        if (!fenParts.empty())
+        {
+                fen = fenParts[0];
+                for (size_t i = 1; i < fenParts.size(); i++)
+                        fen += " " + fenParts[i];
+        }
+
+        BoardState boardState;
+        if (applyFEN(fen, boardState) != 0)
+        {
+                std::cerr << "Error parsing FEN\n";
+                return -1;
+        }
+
+        // --hash 0 searches without a table
+        TranspositionTable tt;
+        if (hashMegabytes > 0 && initTranspositionTable(tt, hashMegabytes, hugePages) != 0)
+                return -1;
+
+        SearchResult result = search(boardState, limits, true, hashMegabytes > 0 ? &tt : nullptr, numThreads);
+        if (result.bestMove == MOVE_NONE)
+        {
+                std::cout << "No legal moves\n";
+                freeTranspositionTable(tt);
+                return 0;
+        }
+        std::cout << "bestmove " << moveToString(result.bestMove) << "\n";
+        std::cout << "Nodes: " << result.nodes << ", time: " << result.seconds << " s, nodes/sec: "
+                  << (uint64_t)(result.nodes / (result.seconds > 0.0 ? result.seconds : 1e-9)) << "\n";
+        printCutoffStats(result.cutoffStats);
+        if (hashMegabytes > 0)
+                printTTStats(tt, result.ttStats);
+        freeTranspositionTable(tt);
+        return 0;
+}
+
+int benchCommand(int argc, char** argv)
+{
+        int depth = 7;
+        size_t hashMegabytes = 16;
+        bool valid = true;
+        try
+        {
+                for (int i = 2; i < argc && valid; i++)
+                {
+                        std::string arg = argv[i];
+                        if ((arg == "--depth" || arg == "--hash") && i + 1 < argc)
+                        {
+                                int value = std::stoi(argv[++i]);
+                                if (arg == "--depth")
+                                        depth = value < MAX_SEARCH_PLY ? value : MAX_SEARCH_PLY - 1;
+                                else
+                                        hashMegabytes = (size_t)value;
+                                valid = arg == "--depth" ? value >= 1 : value >= 0;
+                        }
+                        else
+                        {
+                                valid = false;
+                        }
+                }
+        }
+        catch (const std::invalid_argument& e)
+        {
+                valid = false;
+        }
+        catch (const std::out_of_range& e)
+        {
+                valid = false;
+        }
+        if (!valid)
+        {
+                std::cerr << "Usage: " << argv[0] << " bench [--depth <n>] [--hash <MB, 0 for none>]\n";
+                return -1;
+        }
+
+        TranspositionTable tt;
+        if (hashMegabytes > 0 && initTranspositionTable(tt, hashMegabytes, false) != 0)
+                return -1;
+
+        SearchLimits limits;
+        limits.depth = depth;
+        uint64_t totalNodes = 0;
+        double totalSeconds = 0;
+        CutoffStats cutoffStats;
+        int index = 0;
+        for (const char* fen : benchPositions)
+        {
+                BoardState boardState;
+                if (applyFEN(fen, boardState) != 0)
+                {
+                        std::cerr << "Error parsing FEN: " << fen << "\n";
+                        freeTranspositionTable(tt);
+                        return -1;
+                }
+
+                // Every position starts from an empty table so that the count does not depend on order
+                if (hashMegabytes > 0)
+                        clearTranspositionTable(tt);
+                SearchResult result = search(boardState, limits, false, hashMegabytes > 0 ? &tt : nullptr);
+                totalNodes += result.nodes;
+                totalSeconds += result.seconds;
+                addCutoffStats(cutoffStats, result.cutoffStats);
+                std::cout << "Position " << ++index << ": depth " << result.depth << " score " << scoreToString(result.score)
+                          << " bestmove " << moveToString(result.bestMove) << ", " << result.nodes << " nodes, "
+                          << (int64_t)(result.seconds * 1000) << " ms\n";
+        }
+
+        std::cout << "Nodes to depth " << depth << ": " << totalNodes << ", time: " << totalSeconds << " s, nodes/sec: "
+                  << (uint64_t)(totalNodes / (totalSeconds > 0.0 ? totalSeconds : 1e-9)) << "\n";
+        printCutoffStats(cutoffStats);
+        freeTranspositionTable(tt);
+        return 0;
+}
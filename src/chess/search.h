@@ -0,0 +1,108 @@
+#ifndef CHESS_SEARCH_H
+#define CHESS_SEARCH_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "gamestate.h"
+#include "move.h"
+#include "movepicker.h"
+#include "tt.h"
+
+const int MAX_SEARCH_PLY = 64;
+const int SCORE_INFINITE = 32000;
+const int SCORE_MATE = 31000; // mate in n plies scores SCORE_MATE - n
+
+// Zero means no limit, the search stops at whichever limit is reached first
+struct SearchLimits
+{
+        int depth = MAX_SEARCH_PLY - 1;
+        uint64_t nodes = 0;
+        int64_t moveTimeMs = 0;
+};
+
+struct CutoffStats
+{
+        uint64_t cutoffs = 0;   // beta cutoffs in the main search, quiescence not included
+        uint64_t firstMove = 0; // cutoffs by the first legal move tried
+        std::array<uint64_t, PICK_STAGES> byStage = {};
+};
+
+struct SearchResult
+{
+        Move bestMove = MOVE_NONE;
+        int score = 0;
+        int depth = 0; // last completed iteration
+        uint64_t nodes = 0;
+        double seconds = 0;
+        std::array<Move, MAX_SEARCH_PLY> pv;
+        int pvLength = 0;
+        TTStats ttStats;
+        CutoffStats cutoffStats;
+};
+
+// The only state threads of one search share besides the transposition table,
+// touched once every 2048 nodes
+struct SharedSearch
+{
+        std::atomic<bool> stop{false};      // set by the main thread when a limit is reached
+        std::atomic<uint64_t> nodes{0};     // approximate total over all threads
+};
+
+// Everything one search thread mutates, the root position is copied in
+struct SearchState
+{
+        int threadIndex = 0; // 0 is the main thread, it checks the limits and reports
+        SharedSearch* shared = nullptr;
+        SearchResult completed; // last iteration this thread finished
+
+        BoardState boardState;
+        UndoStack history;
+        SearchLimits limits;
+        std::chrono::steady_clock::time_point start;
+        uint64_t nodes = 0;
+        bool stopped = false;
+        TranspositionTable* tt = nullptr; // shared, may be null
+        TTStats ttStats;
+        CutoffStats cutoffStats;
+
+        // Move ordering state, killers are the last two quiet moves that cut at each ply
+        MoveHistory moveHistory;
+        std::array<std::array<Move, 2>, MAX_SEARCH_PLY> killers = {};
+        std::array<Move, MAX_SEARCH_PLY> moveStack; // move made at each ply, for countermoves
+
+        // Triangular PV table, row ply holds the best line found from that ply
+        std::array<std::array<Move, MAX_SEARCH_PLY>, MAX_SEARCH_PLY> pvTable;
+        std::array<int, MAX_SEARCH_PLY> pvLength;
+        std::array<Move, MAX_SEARCH_PLY> previousPV; // searched first in the next iteration
+        int previousPVLength = 0;
+        bool followPV = false;
+};
+
+// Static evaluation in centipawns from the side to move's point of view
+int evaluate(const BoardState& boardState);
+
+// Principal variation search with iterative deepening, report prints one line per completed iteration.
+// Entries in tt are kept between searches, newSearch ages them at the start of each one.
+// With more than one thread, helpers search the same root at staggered depths (Lazy SMP) and
+// only meet through tt, the result comes from whichever thread completed the deepest iteration.
+SearchResult search(const BoardState& boardState, const SearchLimits& limits, bool report = true, TranspositionTable* tt = nullptr,
+                    int numThreads = 1);
+std::string scoreToString(int score);
+void addCutoffStats(CutoffStats& total, const CutoffStats& stats);
+void printCutoffStats(const CutoffStats& stats);
+
+// Time to depth over a fixed set of positions at 1, 2, 4, ... maxThreads threads
+int runSearchScaling(int depth, int maxThreads, size_t hashMegabytes);
+
+// search [--depth <n>] [--nodes <n>] [--movetime <ms>] [--threads <n>] [--hash <MB>] [--hugepages] [fen]
+// or search scaling [--depth <n>] [--threads <max threads>] [--hash <MB>]
+int searchCommand(int argc, char** argv);
+
+// Nodes to depth over the same fixed positions, bench [--depth <n>] [--hash <MB>]
+int benchCommand(int argc, char** argv);
+
+#endif // CHESS_SEARCH_H
@@ -0,0 +1,151 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "selftest.h"
+#include "fen.h"
+#include "movement.h"
+#include "movepicker.h"
+#include "perft.h"
+#include "search.h"
+
+// Runs command with the words of line as its arguments, the usage it prints is swallowed
+int runCommandLine(int (*command)(int, char**), const std::string& line)
+{
+        std::vector<std::string> words = {"main"};
+        std::istringstream stream(line);
+        std::string word;
+        while (stream >> word)
+                words.push_back(word);
+
+        std::vector<char*> argv;
+        for (std::string& w : words)
+                argv.push_back(&w[0]);
+        argv.push_back(nullptr);
+
+        std::ostringstream discarded;
+        std::streambuf* errorBuffer = std::cerr.rdbuf(discarded.rdbuf());
+        int result = command((int)words.size(), argv.data());
+        std::cerr.rdbuf(errorBuffer);
+        return result;
+}
+
+bool report(bool passed, const std::string& name)
+{
+        std::cout << (passed ? "[ OK ] " : "[FAIL] ") << name << "\n";
+        return passed;
+}
+
+int testPerftArguments()
+{
+        const char* const rejected[] = {
+                "perft",
+                "perft 0",
+                "perft -1",
+                "divide 0",
+                "perft abc",
+                "perft 65",
+                "perft 256",
+                "perft 99999999999",
+                "perft 3 --threads",
+                "perft 3 --split",
+                "perft 3 --hash",
+                "perft 3 --threads x",
+                "perft 3 --hash -1",
+                "perft 3 --hash 2000000",
+                "perft suite x"
+        };
+
+        int failed = 0;
+        for (const char* line : rejected)
+        {
+                if (!report(runCommandLine(perftCommand, line) == -1, std::string("rejects '") + line + "'"))
+                        failed++;
+        }
+        return failed;
+}
+
+// Sizes past MAX_TT_MEGABYTES used to overflow the size in bytes
+int testHashSizes()
+{
+        struct Case
+        {
+                int (*command)(int, char**);
+                const char* line;
+        };
+        const Case rejected[] = {
+                {searchCommand, "search --hash 2000000"},
+                {searchCommand, "search --hash 99999999999999"},
+                {benchCommand, "bench --hash 2000000"}
+        };
+
+        int failed = 0;
+        for (const Case& c : rejected)
+        {
+                if (!report(runCommandLine(c.command, c.line) == -1, std::string("rejects '") + c.line + "'"))
+                        failed++;
+        }
+        return failed;
+}
+
+int testStaticExchange()
+{
+        struct Case
+        {
+                const char* fen;
+                const char* move;
+                int score;
+        };
+        const Case cases[] = {
+                // The pawn on d6 defends e5, the rooks behind join in
+                {"4r1k1/8/3p4/4p3/8/5N2/8/4R1K1 w - - 0 1", "f3e5", -220},
+                {"4r1k1/8/3p4/4p3/8/5N2/8/4R1K1 w - - 0 1", "e1e5", -400},
+                // Bishop takes knight, pawn takes bishop, pawn takes pawn
+                {"4k3/8/3p4/4n3/3P4/6B1/8/4K3 w - - 0 1", "g3e5", 90}
+        };
+
+        int failed = 0;
+        for (const Case& c : cases)
+        {
+                BoardState boardState;
+                MoveList moves;
+                int score = 0;
+                bool found = false;
+                if (applyFEN(c.fen, boardState) == 0)
+                {
+                        generateLegalMoves(boardState, moves);
+                        for (int i = 0; i < moves.count; i++)
+                        {
+                                if (moveToString(moves.moves[i]) == c.move)
+                                {
+                                        score = staticExchange(boardState, moves.moves[i]);
+                                        found = true;
+                                }
+                        }
+                }
+                std::string name = std::string("SEE of ") + c.move + " is " + std::to_string(c.score);
+                if (found && score != c.score)
+                        name += ", got " + std::to_string(score);
+                else if (!found)
+                        name += ", move not found";
+                if (!report(found && score == c.score, name))
+                        failed++;
+        }
+        return failed;
+}
+
+int runSelfTests()
+{
+        int failed = 0;
+        failed += testPerftArguments();
+        failed += testHashSizes();
+        failed += testStaticExchange();
+
+        std::cout << "\n";
+        if (failed)
+                std::cout << "Failed: " << failed << "\n";
+        else
+                std::cout << "All passed\n";
+        return failed;
+}
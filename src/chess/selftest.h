@@ -0,0 +1,8 @@
+#ifndef CHESS_SELFTEST_H
+#define CHESS_SELFTEST_H
+
+// Checks that need no window or long search: command-line validation and exact results of
+// small helpers. Prints one line per case and returns the number of failures.
+int runSelfTests();
+
+#endif // CHESS_SELFTEST_H
@@ -0,0 +1,49 @@
+#ifndef CHESS_SPSCQUEUE_H
+#define CHESS_SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// head and tail only ever grow, the slot is their value modulo Capacity.
+template <typename T, size_t Capacity>
+struct SPSCQueue
+{
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+        alignas(64) std::atomic<size_t> head{0}; // written by the consumer
+        alignas(64) std::atomic<size_t> tail{0}; // written by the producer
+        std::array<T, Capacity> slots;
+
+        // Producer only, returns false if the queue is full
+        bool push(const T& value)
+        {
+                size_t t = tail.load(std::memory_order_relaxed);
+                if (t - head.load(std::memory_order_acquire) == Capacity)
+                        return false;
+
+                slots[t & (Capacity - 1)] = value;
+                tail.store(t + 1, std::memory_order_release);
+                return true;
+        }
+
+        // Consumer only, returns false if the queue is empty
+        bool pop(T& value)
+        {
+                size_t h = head.load(std::memory_order_relaxed);
+                if (h == tail.load(std::memory_order_acquire))
+                        return false;
+
+                value = slots[h & (Capacity - 1)];
+                head.store(h + 1, std::memory_order_release);
+                return true;
+        }
+
+        bool empty() const
+        {
+                return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+};
+
+#endif // CHESS_SPSCQUEUE_H
@@ -0,0 +1,189 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "tt.h"
+#include "search.h"
+
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+int initTranspositionTable(TranspositionTable& tt, size_t megabytes, bool hugePages)
+{
+        freeTranspositionTable(tt);
+        if (megabytes == 0 || megabytes > MAX_TT_MEGABYTES)
+        {
+                std::cerr << "Transposition table size must be between 1 and " << MAX_TT_MEGABYTES << " MB\n";
+                return -1;
+        }
+
+        uint64_t bucketCount = 1;
+        while (bucketCount * 2 * sizeof(TTBucket) <= megabytes * 1024 * 1024)
+                bucketCount *= 2;
+        size_t bytes = bucketCount * sizeof(TTBucket);
+
+        // Huge pages need the table aligned to the page size, the size is a power of two
+        // of at least a megabyte, so it is also a multiple of it once it reaches 2 MB
+        size_t alignment = hugePages && bytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : alignof(TTBucket);
+        void* memory = std::aligned_alloc(alignment, bytes);
+        if (!memory)
+        {
+                std::cerr << "Failed to allocate a " << megabytes << " MB transposition table\n";
+                return -1;
+        }
+
+        tt.hugePages = false;
+#ifdef MADV_HUGEPAGE
+        if (hugePages && alignment == HUGE_PAGE_SIZE)
+                tt.hugePages = madvise(memory, bytes, MADV_HUGEPAGE) == 0;
+#endif
+        if (hugePages && !tt.hugePages)
+                std::cerr << "Huge pages are not available, using normal pages\n";
+
+        tt.buckets.reset((TTBucket*)memory);
+        tt.bucketMask = bucketCount - 1;
+        tt.bytes = bytes;
+        clearTranspositionTable(tt);
+        return 0;
+}
+
+void freeTranspositionTable(TranspositionTable& tt)
+{
+        tt = TranspositionTable();
+}
+
+// Also touches every page so that the first search does not pay for the page faults
+void clearTranspositionTable(TranspositionTable& tt)
+{
+        memset((void*)tt.buckets.get(), 0, tt.bytes);
+        tt.age = 0;
+}
+
+void newSearch(TranspositionTable& tt)
+{
+        tt.age = (tt.age + 1) & 63;
+}
+
+int scoreToTT(int score, int ply)
+{
+        if (score >= SCORE_MATE - MAX_SEARCH_PLY)
+                return score + ply;
+        if (score <= -SCORE_MATE + MAX_SEARCH_PLY)
+                return score - ply;
+        return score;
+}
+
+int scoreFromTT(int score, int ply)
+{
+        if (score >= SCORE_MATE - MAX_SEARCH_PLY)
+                return score - ply;
+        if (score <= -SCORE_MATE + MAX_SEARCH_PLY)
+                return score + ply;
+        return score;
+}
+
+inline int entryAge(uint64_t data)
+{
+        return (int)(data >> 42) & 63;
+}
+
+inline int entryDepth(uint64_t data)
+{
+        return (int)(data >> 32) & 0xFF;
+}
+
+inline int entryBound(uint64_t data)
+{
+        return (int)(data >> 40) & 3;
+}
+
+bool probeTT(const TranspositionTable& tt, uint64_t key, int ply, TTProbe& probe, TTStats& stats)
+{
+        stats.probes++;
+        const TTBucket& bucket = tt.buckets[key & tt.bucketMask];
+        for (const TTEntry& entry : bucket.entries)
+        {
+                uint64_t data = entry.data.load(std::memory_order_relaxed);
+                uint64_t keyXorData = entry.keyXorData.load(std::memory_order_relaxed);
+                if ((keyXorData ^ data) == key && entryBound(data) != BOUND_NONE)
+                {
+                        probe.move = (Move)(data & 0xFFFF);
+                        probe.score = scoreFromTT((int16_t)(data >> 16), ply);
+                        probe.depth = entryDepth(data);
+                        probe.bound = entryBound(data);
+                        stats.hits++;
+                        return true;
+                }
+        }
+        return false;
+}
+
+void storeTT(TranspositionTable& tt, uint64_t key, int ply, Move move, int score, int depth, int bound, TTStats& stats)
+{
+        TTBucket& bucket = tt.buckets[key & tt.bucketMask];
+
+        // The same position is overwritten in place, otherwise the entry with the lowest
+        // depth is replaced, counting every search since it was written as 8 plies less
+        TTEntry* replace = nullptr;
+        uint64_t replacedData = 0;
+        int replaceValue = 1 << 30;
+        for (TTEntry& entry : bucket.entries)
+        {
+                uint64_t data = entry.data.load(std::memory_order_relaxed);
+                uint64_t keyXorData = entry.keyXorData.load(std::memory_order_relaxed);
+                if ((keyXorData ^ data) == key)
+                {
+                        // Keep the old move rather than forget it when this node found none
+                        if (move == MOVE_NONE)
+                                move = (Move)(data & 0xFFFF);
+                        replace = &entry;
+                        replacedData = 0;
+                        break;
+                }
+
+                int value = entryBound(data) == BOUND_NONE ? -(1 << 30) : entryDepth(data) - 8 * ((tt.age - entryAge(data)) & 63);
+                if (value < replaceValue)
+                {
+                        replace = &entry;
+                        replacedData = data;
+                        replaceValue = value;
+                }
+        }
+
+        stats.stores++;
+        if (entryBound(replacedData) != BOUND_NONE && entryAge(replacedData) == tt.age)
+                stats.collisions++;
+
+        uint64_t data = (uint64_t)move | (uint64_t)(uint16_t)(int16_t)scoreToTT(score, ply) << 16 |
+                        (uint64_t)(depth & 0xFF) << 32 | (uint64_t)bound << 40 | (uint64_t)tt.age << 42;
+        replace->data.store(data, std::memory_order_relaxed);
+        replace->keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+double ttOccupancy(const TranspositionTable& tt)
+{
+        const uint64_t sampleBuckets = 1024;
+        uint64_t buckets = tt.bucketMask + 1 < sampleBuckets ? tt.bucketMask + 1 : sampleBuckets;
+        uint64_t used = 0;
+        for (uint64_t i = 0; i < buckets; i++)
+        {
+                for (const TTEntry& entry : tt.buckets[i].entries)
+                {
+                        uint64_t data = entry.data.load(std::memory_order_relaxed);
+                        if (entryBound(data) != BOUND_NONE && entryAge(data) == tt.age)
+                                used++;
+                }
+        }
+        return (double)used / (buckets * 4);
+}
+
+void printTTStats(const TranspositionTable& tt, const TTStats& stats)
+{
+        std::cout << "TT: " << tt.bytes / (1024 * 1024) << " MB" << (tt.hugePages ? " (huge pages)" : "") << ", "
+                  << stats.probes << " probes, " << stats.hits << " hits (" << 100.0 * stats.hits / (stats.probes ? stats.probes : 1)
+                  << "%), " << stats.stores << " stores, " << stats.collisions << " collisions, "
+                  << 100.0 * ttOccupancy(tt) << "% occupied\n";
+}
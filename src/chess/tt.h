@@ -0,0 +1,81 @@
+#ifndef CHESS_TT_H
+#define CHESS_TT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+#include "move.h"
+
+enum TTBound
+{
+        BOUND_NONE = 0, // empty entry
+        BOUND_UPPER,    // score <= stored score, fail low
+        BOUND_LOWER,    // score >= stored score, fail high
+        BOUND_EXACT
+};
+
+// Same lockless scheme as the perft hash, a torn entry fails the key check.
+// data: bits 0-15 move, 16-31 score, 32-39 depth, 40-41 bound, 42-47 age
+struct TTEntry
+{
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+};
+
+struct alignas(64) TTBucket
+{
+        TTEntry entries[4]; // one cache line
+};
+
+// Keeps the size in bytes far from overflowing
+const size_t MAX_TT_MEGABYTES = 1 << 20;
+
+// The table comes from aligned_alloc, so it has to go back through free
+struct FreeDeleter
+{
+        void operator()(void* memory) const { std::free(memory); }
+};
+
+struct TranspositionTable
+{
+        std::unique_ptr<TTBucket[], FreeDeleter> buckets;
+        uint64_t bucketMask = 0;
+        size_t bytes = 0;
+        bool hugePages = false; // the kernel was asked to back the table with huge pages
+        uint8_t age = 0;        // bumped by newSearch, older entries are replaced first
+};
+
+struct TTProbe
+{
+        Move move;
+        int score;
+        int depth;
+        int bound;
+};
+
+// Kept per search thread so that counting does not contend
+struct TTStats
+{
+        uint64_t probes = 0;
+        uint64_t hits = 0;
+        uint64_t stores = 0;
+        uint64_t collisions = 0; // stores that evicted another position from the current search
+};
+
+int initTranspositionTable(TranspositionTable& tt, size_t megabytes, bool hugePages);
+void freeTranspositionTable(TranspositionTable& tt);
+void clearTranspositionTable(TranspositionTable& tt);
+void newSearch(TranspositionTable& tt);
+
+// Mate scores are stored relative to the node, ply converts them back and forth
+bool probeTT(const TranspositionTable& tt, uint64_t key, int ply, TTProbe& probe, TTStats& stats);
+void storeTT(TranspositionTable& tt, uint64_t key, int ply, Move move, int score, int depth, int bound, TTStats& stats);
+
+// Share of sampled entries written during the current search
+double ttOccupancy(const TranspositionTable& tt);
+void printTTStats(const TranspositionTable& tt, const TTStats& stats);
+
+#endif // CHESS_TT_H
@@ -0,0 +1,61 @@
+#include "zobrist.h"
+
+ZobristKeys zobrist;
+
+// splitmix64 with a fixed seed so that keys are the same on every run
+uint64_t nextZobristKey(uint64_t& state)
+{
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+}
+
+void initZobrist()
+{
+        uint64_t state = 0x4368657373ULL;
+        for (int side = WHITE; side <= BLACK; side++)
+        {
+                zobrist.pieces[side][NONE].fill(0);
+                for (int type = PAWN; type <= KING; type++)
+                {
+                        for (int square = 0; square < 64; square++)
+                                zobrist.pieces[side][type][square] = nextZobristKey(state);
+                }
+        }
+
+        zobrist.blackToMove = nextZobristKey(state);
+        for (uint64_t& key : zobrist.castling)
+                key = nextZobristKey(state);
+        for (uint64_t& key : zobrist.enPassantFile)
+                key = nextZobristKey(state);
+}
+
+uint64_t computeHash(const BoardState& boardState)
+{
+        uint64_t hash = 0;
+        for (int side = WHITE; side <= BLACK; side++)
+        {
+                for (int type = PAWN; type <= KING; type++)
+                {
+                        Bitboard pieces = boardState.pieceBB[type] & boardState.colorBB[side];
+                        while (pieces)
+                                hash ^= zobrist.pieces[side][type][popLSB(pieces)];
+                }
+        }
+
+        if (!boardState.isWhiteTurn)
+                hash ^= zobrist.blackToMove;
+        if (boardState.whiteCanCastleKingside)
+                hash ^= zobrist.castling[0];
+        if (boardState.whiteCanCastleQueenside)
+                hash ^= zobrist.castling[1];
+        if (boardState.blackCanCastleKingside)
+                hash ^= zobrist.castling[2];
+        if (boardState.blackCanCastleQueenside)
+                hash ^= zobrist.castling[3];
+        if (boardState.enPassantSquare != -1)
+                hash ^= zobrist.enPassantFile[boardState.enPassantSquare % 8];
+
+        return hash;
+}
@@ -0,0 +1,23 @@
+#ifndef CHESS_ZOBRIST_H
+#define CHESS_ZOBRIST_H
+
+#include <array>
+#include <cstdint>
+
+#include "gamestate.h"
+
+struct ZobristKeys
+{
+        std::array<std::array<std::array<uint64_t, 64>, 7>, 2> pieces; // [Side][PieceType][square]
+        uint64_t blackToMove;
+        std::array<uint64_t, 4> castling; // K, Q, k, q
+        std::array<uint64_t, 8> enPassantFile;
+};
+
+extern ZobristKeys zobrist;
+
+// must be called once before any hashing
+void initZobrist();
+uint64_t computeHash(const BoardState& boardState);
+
+#endif // CHESS_ZOBRIST_H
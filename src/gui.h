@@ -2,16 +2,28 @@
 #define GUI_H
 
 #include <GLFW/glfw3.h>
-#include <string>
 
 #include "datatypes.h"
 
-// layer [0, 1, 2, ...], 0 is the furthest layer, 1 is the next furthest, etc.
-void drawSquare(Vector2f pos, int layer, float width, Color color);
-void drawSquare(const Square& square, int layer);
-void drawTexture(Vector2f pos, int layer, float width, const std::string& texturePath);
-void drawTexture(const Square& square, int layer, const std::string& texturePath);
+// Cursor positions in window coordinates to OpenGL coordinates, kept per window size
+// so that a click does not have to query the window
+struct CursorMapping
+{
+        int width = 0;
+        int height = 0;
+        double scaleX = 0, offsetX = 0;
+        double scaleY = 0, offsetY = 0;
+};
+
 void reshapeWindow(GLFWwindow* window);
+// GLFW must already be initialized, the caller also terminates it, even when this fails
 GLFWwindow* init(const char* title, int width, int height);
-void convertToOpenGLCoords(double& x, double& y, GLFWwindow* window);
+// Call with the window size (not the framebuffer size), cursor positions use the same units
+void updateCursorMapping(CursorMapping& mapping, int width, int height);
+
+inline void cursorToOpenGL(const CursorMapping& mapping, double& x, double& y)
+{
+        x = x * mapping.scaleX + mapping.offsetX;
+        y = y * mapping.scaleY + mapping.offsetY;
+}
 #endif
@@ -1,7 +1,54 @@
+#include <iostream>
+#include <string>
+
 #include "chess.h"
+#include "chess/bitboard.h"
+#include "chess/diagram.h"
+#include "chess/perft.h"
+#include "chess/search.h"
+#include "chess/selftest.h"
+#include "chess/zobrist.h"
+#include "profiler.h"
 
 int main(int argc, char** argv)
 {
+        initBitboards();
+        initZobrist();
+
+        std::string command = argc > 1 ? argv[1] : "";
+        if (command == "perft" || command == "divide")
+                return perftCommand(argc, argv) == 0 ? 0 : 1;
+        if (command == "search")
+                return searchCommand(argc, argv) == 0 ? 0 : 1;
+        if (command == "bench")
+                return benchCommand(argc, argv) == 0 ? 0 : 1;
+        if (command == "test")
+                return runSelfTests() == 0 ? 0 : 1;
+        if (command == "render")
+                return renderCommand(argc, argv) == 0 ? 0 : 1;
+
+        // --profile prints frame percentiles while running, --trace <file> writes a Chrome trace on exit
+        std::string tracePath;
+        for (int i = 1; i < argc; i++)
+        {
+                std::string arg = argv[i];
+                if (arg == "--profile")
+                {
+                        profiler.enabled = true;
+                        profiler.overlay = true;
+                }
+                else if (arg == "--trace" && i + 1 < argc)
+                {
+                        profiler.enabled = true;
+                        tracePath = argv[++i];
+                }
+        }
+
         chess();
+
+        if (profiler.enabled)
+                printProfileReport(std::cout);
+        if (!tracePath.empty())
+                exportChromeTrace(tracePath);
         return 0;
 }
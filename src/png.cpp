@@ -0,0 +1,213 @@
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+#include "png.h"
+
+std::array<uint32_t, 256> makeCRCTable()
+{
+        std::array<uint32_t, 256> table;
+        for (uint32_t n = 0; n < 256; n++)
+        {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                        c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+        }
+        return table;
+}
+
+const std::array<uint32_t, 256> crcTable = makeCRCTable();
+
+uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+                crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+}
+
+uint32_t adler32(const std::vector<unsigned char>& data)
+{
+        uint32_t a = 1, b = 0;
+        size_t i = 0;
+        while (i < data.size())
+        {
+                // 5552 bytes is the most that can be summed before b may overflow
+                size_t end = i + 5552 < data.size() ? i + 5552 : data.size();
+                for (; i < end; i++)
+                {
+                        a += data[i];
+                        b += a;
+                }
+                a %= 65521;
+                b %= 65521;
+        }
+        return (b << 16) | a;
+}
+
+void putU32(std::vector<unsigned char>& out, uint32_t value)
+{
+        out.push_back((unsigned char)(value >> 24));
+        out.push_back((unsigned char)(value >> 16));
+        out.push_back((unsigned char)(value >> 8));
+        out.push_back((unsigned char)value);
+}
+
+void putChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+{
+        putU32(out, (uint32_t)data.size());
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        putU32(out, crc32(&out[start], out.size() - start));
+}
+
+// Deflate bits are packed starting at the least significant bit of each byte
+struct BitWriter
+{
+        std::vector<unsigned char>& out;
+        uint32_t buffer = 0;
+        int count = 0;
+
+        void write(uint32_t bits, int length)
+        {
+                buffer |= bits << count;
+                count += length;
+                while (count >= 8)
+                {
+                        out.push_back((unsigned char)buffer);
+                        buffer >>= 8;
+                        count -= 8;
+                }
+        }
+
+        // Huffman codes are defined most significant bit first
+        void writeCode(uint32_t code, int length)
+        {
+                uint32_t reversed = 0;
+                for (int i = 0; i < length; i++)
+                        reversed |= ((code >> i) & 1) << (length - 1 - i);
+                write(reversed, length);
+        }
+
+        void flush()
+        {
+                if (count > 0)
+                        out.push_back((unsigned char)buffer);
+                buffer = 0;
+                count = 0;
+        }
+};
+
+void writeLiteral(BitWriter& bits, int symbol)
+{
+        if (symbol < 144)
+                bits.writeCode(0x30 + symbol, 8);
+        else if (symbol < 256)
+                bits.writeCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280)
+                bits.writeCode(symbol - 256, 7);
+        else
+                bits.writeCode(0xC0 + symbol - 280, 8);
+}
+
+const int lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const int lengthExtraBits[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// Repeats the previous byte length times, distance 1 is code 0 without extra bits
+void writeRun(BitWriter& bits, int length)
+{
+        int code = 28;
+        while (lengthBase[code] > length)
+                code--;
+        writeLiteral(bits, 257 + code);
+        bits.write(length - lengthBase[code], lengthExtraBits[code]);
+        bits.writeCode(0, 5);
+}
+
+// A single fixed-Huffman block with run-length matches only. After filtering, the flat
+// areas that make up most of a board diagram are long runs of zeros.
+void deflateFixed(const std::vector<unsigned char>& data, std::vector<unsigned char>& out)
+{
+        BitWriter bits{out};
+        bits.write(1, 1); // final block
+        bits.write(1, 2); // fixed Huffman codes
+
+        size_t i = 0;
+        while (i < data.size())
+        {
+                size_t length = 0;
+                if (i > 0)
+                {
+                        while (i + length < data.size() && length < 258 && data[i + length] == data[i - 1])
+                                length++;
+                }
+
+                if (length >= 3)
+                {
+                        writeRun(bits, (int)length);
+                        i += length;
+                }
+                else
+                {
+                        writeLiteral(bits, data[i]);
+                        i++;
+                }
+        }
+
+        writeLiteral(bits, 256);
+        bits.flush();
+}
+
+void encodePNG(const Image& image, std::vector<unsigned char>& out)
+{
+        const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        out.assign(signature, signature + 8);
+
+        std::vector<unsigned char> header;
+        putU32(header, (uint32_t)image.width);
+        putU32(header, (uint32_t)image.height);
+        header.push_back(8);                           // bit depth
+        header.push_back(image.channels == 4 ? 6 : 2); // RGBA or RGB
+        header.push_back(0);                           // deflate
+        header.push_back(0);                           // adaptive filtering
+        header.push_back(0);                           // no interlace
+        putChunk(out, "IHDR", header);
+
+        // Every row uses the Sub filter, so flat runs become zeros
+        size_t stride = (size_t)image.width * image.channels;
+        std::vector<unsigned char> filtered;
+        filtered.reserve((stride + 1) * image.height);
+        for (int y = 0; y < image.height; y++)
+        {
+                const unsigned char* row = &image.pixels[y * stride];
+                filtered.push_back(1);
+                for (size_t x = 0; x < stride; x++)
+                        filtered.push_back((unsigned char)(row[x] - (x >= (size_t)image.channels ? row[x - image.channels] : 0)));
+        }
+
+        std::vector<unsigned char> compressed = {0x78, 0x01};
+        deflateFixed(filtered, compressed);
+        putU32(compressed, adler32(filtered));
+        putChunk(out, "IDAT", compressed);
+
+        putChunk(out, "IEND", {});
+}
+
+int writePNG(const std::string& path, const Image& image)
+{
+        std::vector<unsigned char> png;
+        encodePNG(image, png);
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file.write((const char*)png.data(), png.size()))
+        {
+                std::cerr << "Failed to write " << path << "\n";
+                return -1;
+        }
+        return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef PNG_H
+#define PNG_H
+
+#include <string>
+#include <vector>
+
+#include "texture.h"
+
+// 8-bit RGB or RGBA depending on image.channels
+void encodePNG(const Image& image, std::vector<unsigned char>& out);
+int writePNG(const std::string& path, const Image& image);
+
+#endif
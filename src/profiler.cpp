@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "profiler.h"
+
+Profiler profiler;
+
+uint32_t profileThreadId()
+{
+        static std::atomic<uint32_t> threadCount{0};
+        thread_local uint32_t id = threadCount++;
+        return id;
+}
+
+void recordProfileEvent(const char* name, uint64_t startNs, uint64_t durationNs)
+{
+        ProfileEvent& event = profiler.events[profiler.next.fetch_add(1, std::memory_order_relaxed) % PROFILE_EVENTS];
+        event.name.store(name, std::memory_order_relaxed);
+        event.startNs.store(startNs, std::memory_order_relaxed);
+        event.durationNs.store(durationNs, std::memory_order_relaxed);
+        event.thread.store(profileThreadId(), std::memory_order_relaxed);
+}
+
+struct ProfileSample
+{
+        const char* name;
+        uint64_t startNs;
+        uint64_t durationNs;
+        uint32_t thread;
+};
+
+// Oldest first
+std::vector<ProfileSample> collectProfileSamples()
+{
+        uint64_t end = profiler.next.load(std::memory_order_relaxed);
+        uint64_t begin = end > PROFILE_EVENTS ? end - PROFILE_EVENTS : 0;
+
+        std::vector<ProfileSample> samples;
+        samples.reserve(end - begin);
+        for (uint64_t i = begin; i < end; i++)
+        {
+                const ProfileEvent& event = profiler.events[i % PROFILE_EVENTS];
+                ProfileSample sample = {event.name.load(std::memory_order_relaxed), event.startNs.load(std::memory_order_relaxed),
+                                        event.durationNs.load(std::memory_order_relaxed), event.thread.load(std::memory_order_relaxed)};
+                if (sample.name)
+                        samples.push_back(sample);
+        }
+        return samples;
+}
+
+double percentile(const std::vector<uint64_t>& sorted, double fraction)
+{
+        size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+        return (double)sorted[index];
+}
+
+void printProfileReport(std::ostream& out, uint64_t windowNs)
+{
+        uint64_t now = profileNow();
+        std::map<std::string, std::vector<uint64_t>> durations;
+        for (const ProfileSample& sample : collectProfileSamples())
+        {
+                if (windowNs == 0 || sample.startNs + windowNs >= now)
+                        durations[sample.name].push_back(sample.durationNs);
+        }
+
+        out << std::left << std::setw(24) << "scope" << std::right << std::setw(8) << "count" << std::setw(12) << "p50 us"
+            << std::setw(12) << "p99 us" << std::setw(12) << "max us" << "\n";
+        out << std::fixed << std::setprecision(1);
+        for (auto& entry : durations)
+        {
+                std::vector<uint64_t>& values = entry.second;
+                std::sort(values.begin(), values.end());
+                out << std::left << std::setw(24) << entry.first << std::right << std::setw(8) << values.size()
+                    << std::setw(12) << percentile(values, 0.5) / 1000.0 << std::setw(12) << percentile(values, 0.99) / 1000.0
+                    << std::setw(12) << values.back() / 1000.0 << "\n";
+        }
+        out << std::defaultfloat << std::setprecision(6);
+}
+
+void updateProfileOverlay()
+{
+        const uint64_t second = 1000000000;
+        if (!profiler.enabled || !profiler.overlay)
+                return;
+
+        uint64_t now = profileNow();
+        if (now - profiler.lastOverlayNs < second)
+                return;
+        profiler.lastOverlayNs = now;
+
+        printProfileReport(std::cout, second);
+        std::cout << "\n";
+}
+
+void writeJSONString(std::ostream& out, const char* text)
+{
+        out << '"';
+        for (; *text; text++)
+        {
+                if (*text == '"' || *text == '\\')
+                        out << '\\';
+                out << *text;
+        }
+        out << '"';
+}
+
+// Complete ("X") events in microseconds, loadable in chrome://tracing or Perfetto
+int exportChromeTrace(const std::string& path)
+{
+        std::ofstream file(path);
+        if (!file)
+        {
+                std::cerr << "Failed to open " << path << "\n";
+                return -1;
+        }
+
+        std::vector<ProfileSample> samples = collectProfileSamples();
+        file << "{\"traceEvents\":[\n";
+        file << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < samples.size(); i++)
+        {
+                const ProfileSample& sample = samples[i];
+                file << "{\"name\":";
+                writeJSONString(file, sample.name);
+                file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << sample.thread << ",\"ts\":" << sample.startNs / 1000.0
+                     << ",\"dur\":" << sample.durationNs / 1000.0 << "}" << (i + 1 < samples.size() ? ",\n" : "\n");
+        }
+        file << "],\"displayTimeUnit\":\"ms\"}\n";
+
+        if (!file)
+        {
+                std::cerr << "Failed to write " << path << "\n";
+                return -1;
+        }
+        std::cout << "Wrote " << samples.size() << " trace events to " << path << "\n";
+        return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Fields are relaxed atomics so the report can read slots that another thread is
+// overwriting, at worst it sees a mix of two events once the ring has wrapped.
+struct ProfileEvent
+{
+        std::atomic<const char*> name{nullptr}; // must be a string literal
+        std::atomic<uint64_t> startNs{0};       // since the profiler epoch
+        std::atomic<uint64_t> durationNs{0};
+        std::atomic<uint32_t> thread{0};
+};
+
+const size_t PROFILE_EVENTS = 1 << 16;
+
+struct Profiler
+{
+        bool enabled = false;
+        bool overlay = false; // print frame percentiles to stdout about once a second
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        std::atomic<uint64_t> next{0}; // total events recorded, the slot is next % PROFILE_EVENTS
+        std::array<ProfileEvent, PROFILE_EVENTS> events;
+        uint64_t lastOverlayNs = 0;
+};
+
+extern Profiler profiler;
+
+inline uint64_t profileNow()
+{
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profiler.epoch).count();
+}
+
+void recordProfileEvent(const char* name, uint64_t startNs, uint64_t durationNs);
+
+// Records the time between construction and destruction, a single branch when disabled
+struct ScopedTimer
+{
+        const char* name;
+        uint64_t startNs;
+
+        ScopedTimer(const char* name) : name(name), startNs(profiler.enabled ? profileNow() : 0) {}
+        ~ScopedTimer()
+        {
+                if (profiler.enabled)
+                        recordProfileEvent(name, startNs, profileNow() - startNs);
+        }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+// Count, p50, p99 and max per scope name over the events still in the ring buffer,
+// or only those that started in the last windowNs nanoseconds when windowNs is not 0
+void printProfileReport(std::ostream& out, uint64_t windowNs = 0);
+// Call once per rendered frame, prints the last second when the overlay is enabled
+void updateProfileOverlay();
+int exportChromeTrace(const std::string& path);
+
+#endif
@@ -0,0 +1,225 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "renderer.h"
+#include "texture.h"
+
+enum QuadAttribute
+{
+        ATTRIBUTE_POSITION = 0,
+        ATTRIBUTE_TEX_COORD,
+        ATTRIBUTE_COLOR
+};
+
+const char* quadVertexShader =
+        "#version 120\n"
+        "attribute vec3 position;\n"
+        "attribute vec2 texCoord;\n"
+        "attribute vec4 color;\n"
+        "varying vec2 fragTexCoord;\n"
+        "varying vec4 fragColor;\n"
+        "void main()\n"
+        "{\n"
+        "        fragTexCoord = texCoord;\n"
+        "        fragColor = color;\n"
+        "        gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 1.0);\n"
+        "}\n";
+
+const char* quadFragmentShader =
+        "#version 120\n"
+        "uniform sampler2D sprite;\n"
+        "varying vec2 fragTexCoord;\n"
+        "varying vec4 fragColor;\n"
+        "void main()\n"
+        "{\n"
+        "        gl_FragColor = texture2D(sprite, fragTexCoord) * fragColor;\n"
+        "}\n";
+
+GLuint compileShader(GLenum type, const char* source)
+{
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+
+        GLint compiled;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled)
+        {
+                char log[1024];
+                glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+                std::cerr << "Shader compilation failed: " << log << "\n";
+                glDeleteShader(shader);
+                return 0;
+        }
+
+        return shader;
+}
+
+int initRenderer(Renderer& renderer, int maxQuads)
+{
+        GLuint vertexShader = compileShader(GL_VERTEX_SHADER, quadVertexShader);
+        GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, quadFragmentShader);
+        if (!vertexShader || !fragmentShader)
+        {
+                glDeleteShader(vertexShader);
+                glDeleteShader(fragmentShader);
+                return -1;
+        }
+
+        renderer.program = glCreateProgram();
+        glAttachShader(renderer.program, vertexShader);
+        glAttachShader(renderer.program, fragmentShader);
+        glBindAttribLocation(renderer.program, ATTRIBUTE_POSITION, "position");
+        glBindAttribLocation(renderer.program, ATTRIBUTE_TEX_COORD, "texCoord");
+        glBindAttribLocation(renderer.program, ATTRIBUTE_COLOR, "color");
+        glLinkProgram(renderer.program);
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+
+        GLint linked;
+        glGetProgramiv(renderer.program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+                char log[1024];
+                glGetProgramInfoLog(renderer.program, sizeof(log), NULL, log);
+                std::cerr << "Shader linking failed: " << log << "\n";
+                freeRenderer(renderer);
+                return -1;
+        }
+        renderer.spriteLocation = glGetUniformLocation(renderer.program, "sprite");
+
+        // Two triangles per quad, shared by every layer
+        std::vector<uint16_t> indices;
+        for (int quad = 0; quad < maxQuads; quad++)
+        {
+                uint16_t first = (uint16_t)(quad * 4);
+                const uint16_t corners[6] = {0, 1, 2, 0, 2, 3};
+                for (uint16_t corner : corners)
+                        indices.push_back(first + corner);
+        }
+        glGenBuffers(1, &renderer.indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        renderer.maxQuads = maxQuads;
+
+        const unsigned char white[4] = {255, 255, 255, 255};
+        glGenTextures(1, &renderer.whiteTexture);
+        glBindTexture(GL_TEXTURE_2D, renderer.whiteTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        return 0;
+}
+
+void freeRenderer(Renderer& renderer)
+{
+        glDeleteProgram(renderer.program);
+        glDeleteBuffers(1, &renderer.indexBuffer);
+        glDeleteTextures(1, &renderer.whiteTexture);
+        renderer = Renderer();
+}
+
+void initQuadLayer(QuadLayer& layer, int quadCount, GLuint texture)
+{
+        layer.vertices.assign((size_t)quadCount * 4, QuadVertex());
+        layer.texture = texture;
+
+        glGenBuffers(1, &layer.vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, layer.vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, layer.vertices.size() * sizeof(QuadVertex), layer.vertices.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        layer.dirtyBegin = 0;
+        layer.dirtyEnd = 0;
+}
+
+void freeQuadLayer(QuadLayer& layer)
+{
+        glDeleteBuffers(1, &layer.vertexBuffer);
+        layer = QuadLayer();
+}
+
+void writeQuad(QuadLayer& quads, int index, const QuadVertex (&corners)[4])
+{
+        QuadVertex* vertices = &quads.vertices[(size_t)index * 4];
+        if (memcmp(vertices, corners, sizeof(corners)) == 0)
+                return;
+
+        memcpy(vertices, corners, sizeof(corners));
+        if (quads.dirtyBegin == quads.dirtyEnd)
+        {
+                quads.dirtyBegin = index;
+                quads.dirtyEnd = index + 1;
+        }
+        else
+        {
+                quads.dirtyBegin = index < quads.dirtyBegin ? index : quads.dirtyBegin;
+                quads.dirtyEnd = index + 1 > quads.dirtyEnd ? index + 1 : quads.dirtyEnd;
+        }
+}
+
+void setQuad(QuadLayer& quads, int index, Vector2f pos, float width, int layer, Color color, const AtlasRect& rect)
+{
+        float z = -(float)layer / 10000.0f;
+        const QuadVertex corners[4] = {
+                {pos.x, pos.y, z, rect.u0, rect.v0, color.r, color.g, color.b, 1.0f},
+                {pos.x + width, pos.y, z, rect.u1, rect.v0, color.r, color.g, color.b, 1.0f},
+                {pos.x + width, pos.y - width, z, rect.u1, rect.v1, color.r, color.g, color.b, 1.0f},
+                {pos.x, pos.y - width, z, rect.u0, rect.v1, color.r, color.g, color.b, 1.0f}
+        };
+        writeQuad(quads, index, corners);
+}
+
+// A quad with all corners in one place covers no pixels
+void hideQuad(QuadLayer& quads, int index)
+{
+        const QuadVertex corners[4] = {};
+        writeQuad(quads, index, corners);
+}
+
+void drawQuadLayer(const Renderer& renderer, QuadLayer& quads)
+{
+        int quadCount = (int)quads.vertices.size() / 4;
+        if (quadCount > renderer.maxQuads)
+                quadCount = renderer.maxQuads;
+
+        glBindBuffer(GL_ARRAY_BUFFER, quads.vertexBuffer);
+        if (quads.dirtyBegin != quads.dirtyEnd)
+        {
+                glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)quads.dirtyBegin * 4 * sizeof(QuadVertex),
+                                (GLsizeiptr)(quads.dirtyEnd - quads.dirtyBegin) * 4 * sizeof(QuadVertex),
+                                &quads.vertices[(size_t)quads.dirtyBegin * 4]);
+                quads.dirtyBegin = 0;
+                quads.dirtyEnd = 0;
+        }
+
+        glUseProgram(renderer.program);
+        glUniform1i(renderer.spriteLocation, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, quads.texture ? quads.texture : renderer.whiteTexture);
+
+        glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+        glEnableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+        glEnableVertexAttribArray(ATTRIBUTE_COLOR);
+        glVertexAttribPointer(ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (const void*)offsetof(QuadVertex, x));
+        glVertexAttribPointer(ATTRIBUTE_TEX_COORD, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (const void*)offsetof(QuadVertex, u));
+        glVertexAttribPointer(ATTRIBUTE_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (const void*)offsetof(QuadVertex, r));
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.indexBuffer);
+        glDrawElements(GL_TRIANGLES, quadCount * 6, GL_UNSIGNED_SHORT, (const void*)0);
+
+        glDisableVertexAttribArray(ATTRIBUTE_POSITION);
+        glDisableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+        glDisableVertexAttribArray(ATTRIBUTE_COLOR);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glUseProgram(0);
+}
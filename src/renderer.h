@@ -0,0 +1,52 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <GLFW/glfw3.h>
+#include <vector>
+
+#include "datatypes.h"
+
+struct AtlasRect;
+
+struct QuadVertex
+{
+        float x, y, z;
+        float u, v;
+        float r, g, b, a;
+};
+
+// A fixed number of quads kept in a persistent vertex buffer. setQuad only marks a quad
+// dirty when its vertices change, drawQuadLayer uploads the dirty range and draws the
+// whole layer with one call.
+struct QuadLayer
+{
+        std::vector<QuadVertex> vertices; // 4 per quad
+        GLuint vertexBuffer = 0;
+        GLuint texture = 0;
+        int dirtyBegin = 0;
+        int dirtyEnd = 0; // exclusive, in quads
+};
+
+// GLSL 1.20 so that it runs on Mesa's software rasterizer, the projection comes from the
+// fixed-function matrices set up by reshapeWindow
+struct Renderer
+{
+        GLuint program = 0;
+        GLint spriteLocation = -1;
+        GLuint indexBuffer = 0;
+        GLuint whiteTexture = 0; // 1x1, for untextured quads
+        int maxQuads = 0;
+};
+
+// Needs a current GL context
+int initRenderer(Renderer& renderer, int maxQuads);
+void freeRenderer(Renderer& renderer);
+void initQuadLayer(QuadLayer& layer, int quadCount, GLuint texture);
+void freeQuadLayer(QuadLayer& layer);
+
+// layer [0, 1, 2, ...], 0 is the furthest layer, 1 is the next furthest, etc.
+void setQuad(QuadLayer& quads, int index, Vector2f pos, float width, int layer, Color color, const AtlasRect& rect);
+void hideQuad(QuadLayer& quads, int index);
+void drawQuadLayer(const Renderer& renderer, QuadLayer& quads);
+
+#endif
@@ -0,0 +1,215 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "texture.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+unsigned char* loadIMG(const std::string& filename, int& width, int& height, int& channels)
+{
+        unsigned char* img = stbi_load(filename.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!img)
+                return nullptr;
+        return img;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int uploadTexture(TextureCache& cache, const unsigned char* data, int width, int height)
+{
+        Texture texture = {0, width, height};
+        glGenTextures(1, &texture.id);
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+
+        // Pieces are drawn with nearest filtering, so no mipmaps are generated
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        cache.textures.push_back(texture);
+        cache.residentBytes += (size_t)width * height * 4;
+
+        return (int)cache.textures.size() - 1;
+}
+
+// 2x2 box filter, colors are weighted by alpha so transparent texels do not darken the edges
+void downsampleRGBA(const std::vector<unsigned char>& src, int width, int height, std::vector<unsigned char>& dst)
+{
+        int halfWidth = width / 2;
+        int halfHeight = height / 2;
+        dst.assign((size_t)halfWidth * halfHeight * 4, 0);
+
+        for (int y = 0; y < halfHeight; y++)
+        {
+                for (int x = 0; x < halfWidth; x++)
+                {
+                        unsigned color[3] = {0, 0, 0};
+                        unsigned alpha = 0;
+                        for (int i = 0; i < 4; i++)
+                        {
+                                const unsigned char* texel = &src[((size_t)(y * 2 + i / 2) * width + x * 2 + i % 2) * 4];
+                                for (int c = 0; c < 3; c++)
+                                        color[c] += texel[c] * texel[3];
+                                alpha += texel[3];
+                        }
+
+                        unsigned char* out = &dst[((size_t)y * halfWidth + x) * 4];
+                        for (int c = 0; c < 3; c++)
+                                out[c] = alpha ? (unsigned char)((color[c] + alpha / 2) / alpha) : 0;
+                        out[3] = (unsigned char)((alpha + 2) / 4);
+                }
+        }
+}
+
+int loadImage(const std::string& path, Image& image)
+{
+        int width, height, channels;
+        unsigned char* data = loadIMG(path, width, height, channels);
+        if (!data)
+        {
+                std::cerr << "Failed to load image " << path << ": " << stbi_failure_reason() << "\n";
+                return -1;
+        }
+
+        image.width = width;
+        image.height = height;
+        image.channels = 4;
+        image.pixels.assign(data, data + (size_t)width * height * 4);
+        stbi_image_free(data);
+        return 0;
+}
+
+int buildAtlas(TextureCache& cache, TextureAtlas& atlas, const Image* images, int count, int columns)
+{
+        auto start = std::chrono::steady_clock::now();
+
+        int rows = (count + columns - 1) / columns;
+        int cellSize = images[0].width;
+        int width = columns * cellSize;
+        int height = rows * cellSize;
+        std::vector<unsigned char> pixels((size_t)width * height * 4, 0);
+
+        for (int i = 0; i < count; i++)
+        {
+                const Image& sprite = images[i];
+                if (sprite.width != cellSize || sprite.height != cellSize || sprite.channels != 4)
+                {
+                        std::cerr << "Atlas sprites must be square RGBA images of equal size\n";
+                        return -1;
+                }
+
+                int cellX = i % columns * cellSize;
+                int cellY = i / columns * cellSize;
+                for (int y = 0; y < cellSize; y++)
+                        memcpy(&pixels[((size_t)(cellY + y) * width + cellX) * 4], &sprite.pixels[(size_t)y * cellSize * 4], (size_t)cellSize * 4);
+        }
+
+        if (cellSize % (1 << (ATLAS_TIERS - 1)) != 0)
+        {
+                std::cerr << "Atlas sprite size must be divisible by " << (1 << (ATLAS_TIERS - 1)) << "\n";
+                return -1;
+        }
+
+        std::vector<unsigned char> smaller;
+        for (int tier = 0; tier < ATLAS_TIERS; tier++)
+        {
+                if (tier > 0)
+                {
+                        downsampleRGBA(pixels, width, height, smaller);
+                        pixels.swap(smaller);
+                        width /= 2;
+                        height /= 2;
+                        cellSize /= 2;
+                }
+                atlas.tiers[tier] = uploadTexture(cache, pixels.data(), width, height);
+                atlas.cellSizes[tier] = cellSize;
+        }
+        atlas.tier = 0;
+
+        // Filled last, the atlas counts as built once it has rects
+        atlas.rects.clear();
+        for (int i = 0; i < count; i++)
+        {
+                float u = (float)(i % columns) / columns;
+                float v = (float)(i / columns) / rows;
+                atlas.rects.push_back({u, v, u + 1.0f / columns, v + 1.0f / rows});
+        }
+
+        cache.loadMilliseconds += millisecondsSince(start);
+        return 0;
+}
+
+void decodeImages(ImageLoader& loader)
+{
+        int index;
+        while ((index = loader.next++) < (int)loader.paths.size())
+        {
+                if (loadImage(loader.paths[index], loader.images[index]) != 0)
+                        loader.failed++;
+
+                // The last image to finish reports for everyone
+                if (--loader.remaining == 0)
+                {
+                        loader.decodeMilliseconds = millisecondsSince(loader.start);
+                        if (loader.onDone)
+                                loader.onDone();
+                }
+        }
+}
+
+void startImageLoader(ImageLoader& loader, const std::string* paths, int count, void (*onDone)())
+{
+        loader.paths.assign(paths, paths + count);
+        loader.images.assign(count, Image());
+        loader.next = 0;
+        loader.remaining = count;
+        loader.failed = 0;
+        loader.onDone = onDone;
+        loader.start = std::chrono::steady_clock::now();
+
+        int numThreads = (int)std::thread::hardware_concurrency();
+        numThreads = numThreads < 1 ? 1 : numThreads > count ? count : numThreads;
+        for (int i = 0; i < numThreads; i++)
+                loader.threads.emplace_back(decodeImages, std::ref(loader));
+}
+
+int finishImageLoader(ImageLoader& loader)
+{
+        for (std::thread& thread : loader.threads)
+                thread.join();
+        loader.threads.clear();
+        return loader.failed ? -1 : 0;
+}
+
+void selectAtlasTier(TextureAtlas& atlas, int squarePixels)
+{
+        atlas.tier = 0;
+        while (atlas.tier + 1 < ATLAS_TIERS && atlas.cellSizes[atlas.tier + 1] >= squarePixels)
+                atlas.tier++;
+}
+
+void freeTextures(TextureCache& cache)
+{
+        for (const Texture& texture : cache.textures)
+                glDeleteTextures(1, &texture.id);
+
+        cache.textures.clear();
+        cache.residentBytes = 0;
+}
+
+void printTextureStats(const TextureCache& cache)
+{
+        std::cout << "Loaded " << cache.textures.size() << " textures in " << cache.loadMilliseconds << " ms, "
+                  << cache.residentBytes / 1024 << " KiB resident\n";
+}
@@ -0,0 +1,99 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <GLFW/glfw3.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Texture
+{
+        GLuint id;
+        int width, height;
+};
+
+// Textures are decoded and uploaded once, then drawn by handle (the index returned by uploadTexture)
+struct TextureCache
+{
+        std::vector<Texture> textures;
+        size_t residentBytes = 0; // uploaded RGBA8 data
+        double loadMilliseconds = 0;
+};
+
+// Decoded pixels kept in memory, rows top to bottom
+struct Image
+{
+        int width = 0;
+        int height = 0;
+        int channels = 4; // 3 for RGB, 4 for RGBA
+        std::vector<unsigned char> pixels;
+};
+
+// Decodes images on worker threads while the GL thread does other work. The GL thread
+// checks imagesReady and then calls finishImageLoader before touching the images.
+struct ImageLoader
+{
+        std::vector<std::string> paths;
+        std::vector<Image> images;
+        std::vector<std::thread> threads;
+        std::atomic<int> next{0};
+        std::atomic<int> remaining{0};
+        std::atomic<int> failed{0};
+        std::chrono::steady_clock::time_point start;
+        double decodeMilliseconds = 0; // written after remaining reaches 0, valid once finishImageLoader returns
+        void (*onDone)() = nullptr;    // called on a worker thread once every image is decoded
+};
+
+const int ATLAS_TIERS = 3;
+
+struct AtlasRect
+{
+        float u0, v0, u1, v1;
+};
+
+// Equally sized sprites packed row by row into a grid. Each tier halves the cell size of the
+// previous one, the grid layout is the same in every tier so the UV rectangles are shared.
+struct TextureAtlas
+{
+        std::array<int, ATLAS_TIERS> tiers = {};     // TextureCache handles, largest cells first
+        std::array<int, ATLAS_TIERS> cellSizes = {}; // in texels
+        std::vector<AtlasRect> rects;                // one per sprite, in load order, empty until built
+        int tier = 0;
+};
+
+// Needs a current GL context, data is RGBA8 rows top to bottom, returns the handle
+int uploadTexture(TextureCache& cache, const unsigned char* data, int width, int height);
+// Decodes to RGBA without touching GL, safe to call from any thread
+int loadImage(const std::string& path, Image& image);
+void startImageLoader(ImageLoader& loader, const std::string* paths, int count, void (*onDone)());
+// Joins the workers, returns -1 if any image failed to decode
+int finishImageLoader(ImageLoader& loader);
+
+inline bool imagesReady(const ImageLoader& loader)
+{
+        return loader.remaining.load() == 0;
+}
+
+// images must be equally sized square RGBA sprites
+int buildAtlas(TextureCache& cache, TextureAtlas& atlas, const Image* images, int count, int columns);
+// Picks the smallest tier whose cells are at least squarePixels wide
+void selectAtlasTier(TextureAtlas& atlas, int squarePixels);
+void freeTextures(TextureCache& cache);
+void printTextureStats(const TextureCache& cache);
+
+inline GLuint textureId(const TextureCache& cache, int handle)
+{
+        return handle < 0 ? 0 : cache.textures[handle].id;
+}
+
+// No texture until buildAtlas has succeeded, drawing then falls back to placeholders
+inline GLuint atlasTexture(const TextureCache& cache, const TextureAtlas& atlas)
+{
+        return atlas.rects.empty() ? 0 : textureId(cache, atlas.tiers[atlas.tier]);
+}
+
+#endif